@@ -0,0 +1,188 @@
+#include "Antialias.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+
+// Extra samples a refined pixel gets before it is decided whether it needs all of them.
+const int firstSamples = 4;
+
+
+// Refined pixels per task, so their first samples fill a batch.
+const int pixelsPerTask = maxSampleBatch / firstSamples;
+
+
+// A pixel that is refined, with the sum of the colors of its samples so far.
+struct RefinedPixel {
+    int x;
+    int y;
+    int samples;
+    int red;
+    int green;
+    int blue;
+    // no sample so far differs from the pixel's own one
+    bool uniform;
+};
+
+
+// Whether two samples tell that the pixel they are in isn't uniform.
+static bool samplesDiffer(int a, int b, int maxI, int threshold) {
+    a = std::min(a, maxI);
+    b = std::min(b, maxI);
+    return (a == maxI) != (b == maxI) || std::abs(a - b) > threshold;
+}
+
+
+// Whether the loops of pixel (x, y) differ from those of one of its 8 neighbours.
+static bool isEdge(const int* loops, int width, int height, int x, int y, int maxI,
+                   int threshold) {
+    const int own = loops[static_cast<size_t>(y) * width + x];
+    for (int ny = std::max(0, y - 1); ny <= std::min(height - 1, y + 1); ++ny) {
+        const int* row = loops + static_cast<size_t>(ny) * width;
+        for (int nx = std::max(0, x - 1); nx <= std::min(width - 1, x + 1); ++nx) {
+            if (samplesDiffer(own, row[nx], maxI, threshold)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+// Offset of extra sample k of pixel (x, y) from the pixel's own sample, from -0.5 to 0.5
+// pixels in both directions. The offsets follow the R2 low discrepancy sequence, so the
+// first few already cover the pixel evenly, shifted by an amount hashed from the pixel,
+// so neighbouring pixels don't share one pattern. A pixel always gets the same samples,
+// so parts of a frame that don't change don't flicker either.
+static void sampleOffset(int x, int y, int k, double* dx, double* dy) {
+    uint32_t hash = static_cast<uint32_t>(x) * 0x8da6b343u
+                    ^ static_cast<uint32_t>(y) * 0xd8163841u;
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6du;
+    hash ^= hash >> 12;
+    // 1 / g and 1 / g^2 for the plastic number g
+    double u = (hash & 0xffff) / 65536.0 + 0.7548776662466927 * k;
+    double v = (hash >> 16) / 65536.0 + 0.5698402909980532 * k;
+    (*dx) = u - std::floor(u) - 0.5;
+    (*dy) = v - std::floor(v) - 0.5;
+}
+
+
+// Add the color of a sample with the given loops to the pixel.
+static void addColor(const ColorTable* colors, int loops, RefinedPixel* pixel) {
+    uint8_t bytes[4];
+    std::memcpy(bytes, &colors->colors[std::min(loops, colors->maxI)], sizeof(bytes));
+    pixel->red += bytes[0];
+    pixel->green += bytes[1];
+    pixel->blue += bytes[2];
+    pixel->samples++;
+}
+
+
+// Take the extra samples first up to last of every pixel that isn't known to be uniform
+// yet, or of every pixel if all is set, handing them to the sample kernel in batches.
+static void takeSamples(RefinedPixel* pixels, int count, int first, int last, bool all,
+                        const std::vector<int>& loops, int width, const ColorTable* colors,
+                        int threshold, const SampleKernel& sample) {
+    double xs[maxSampleBatch];
+    double ys[maxSampleBatch];
+    int owners[maxSampleBatch];
+    int sampleLoops[maxSampleBatch];
+    int batch = 0;
+    auto flush = [&]() {
+        sample(xs, ys, batch, sampleLoops);
+        for (int i = 0; i < batch; ++i) {
+            RefinedPixel* pixel = &pixels[owners[i]];
+            addColor(colors, sampleLoops[i], pixel);
+            const int own = loops[static_cast<size_t>(pixel->y) * width + pixel->x];
+            if (samplesDiffer(own, sampleLoops[i], colors->maxI, threshold)) {
+                pixel->uniform = false;
+            }
+        }
+        batch = 0;
+    };
+
+    for (int i = 0; i < count; ++i) {
+        if (!all && pixels[i].uniform) {
+            continue;
+        }
+        for (int k = first; k < last; ++k) {
+            double dx;
+            double dy;
+            sampleOffset(pixels[i].x, pixels[i].y, k, &dx, &dy);
+            xs[batch] = pixels[i].x + dx;
+            ys[batch] = pixels[i].y + dy;
+            owners[batch] = i;
+            if (++batch == maxSampleBatch) {
+                flush();
+            }
+        }
+    }
+    if (batch > 0) {
+        flush();
+    }
+}
+
+
+void antialias(ThreadPool *pool, const std::vector<int> &loops, int width, int height,
+               const ColorTable *colors, const Antialiasing *settings,
+               const SampleKernel &sample, FrameBuffer *frameBuffer, AntialiasStats *stats,
+               const std::atomic<bool> *cancel) {
+    (*stats) = {0, 0};
+    if (settings->maxSamples <= 1) {
+        return;
+    }
+    const int maxI = colors->maxI;
+    const int threshold = settings->threshold;
+
+    // find the pixels to refine row by row, then hand them out a few at a time, so the
+    // tasks stay even however the edges are spread over the frame
+    std::vector<std::vector<int>> edges(height);
+    pool->run(height, [&](int y, int worker) {
+        for (int x = 0; x < width; ++x) {
+            if (isEdge(loops.data(), width, height, x, y, maxI, threshold)) {
+                edges[y].push_back(x);
+            }
+        }
+    }, "antialias");
+    std::vector<RefinedPixel> pixels;
+    for (int y = 0; y < height; ++y) {
+        for (int x : edges[y]) {
+            pixels.push_back({x, y, 0, 0, 0, 0, true});
+        }
+    }
+
+    const int count = static_cast<int>(pixels.size());
+    const int firstLast = std::min(1 + firstSamples, settings->maxSamples);
+    std::vector<long> workerSamples(pool->size(), 0);
+    pool->run((count + pixelsPerTask - 1) / pixelsPerTask, [&](int task, int worker) {
+        if (cancel != nullptr && *cancel) {
+            return;
+        }
+        RefinedPixel* first = pixels.data() + task * pixelsPerTask;
+        const int taskCount = std::min(pixelsPerTask, count - task * pixelsPerTask);
+        for (int i = 0; i < taskCount; ++i) {
+            const int own = loops[static_cast<size_t>(first[i].y) * width + first[i].x];
+            addColor(colors, own, &first[i]);
+        }
+        takeSamples(first, taskCount, 1, firstLast, true, loops, width, colors, threshold,
+                    sample);
+        takeSamples(first, taskCount, firstLast, settings->maxSamples, false, loops, width,
+                    colors, threshold, sample);
+        for (int i = 0; i < taskCount; ++i) {
+            const RefinedPixel& pixel = first[i];
+            uint8_t* bytes = pixelAt(frameBuffer, pixel.x, pixel.y);
+            bytes[0] = static_cast<uint8_t>((pixel.red + pixel.samples / 2) / pixel.samples);
+            bytes[1] = static_cast<uint8_t>((pixel.green + pixel.samples / 2)
+                                            / pixel.samples);
+            bytes[2] = static_cast<uint8_t>((pixel.blue + pixel.samples / 2) / pixel.samples);
+            workerSamples[worker] += pixel.samples - 1;
+        }
+    }, "antialias");
+
+    stats->refinedPixels = count;
+    for (long samples : workerSamples) {
+        stats->samples += samples;
+    }
+}
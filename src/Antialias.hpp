@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "ThreadPool.hpp"
+#include "FrameBuffer.hpp"
+#include "Palette.hpp"
+
+
+// Writes the amount of loops of count samples at the (fractional) pixel positions
+// (xs[i], ys[i]) into loops. count is at most maxSampleBatch. Whatever renders the frame
+// (a row kernel or perturbation) is hidden behind this.
+using SampleKernel = std::function<void(const double* xs, const double* ys, int count,
+                                        int* loops)>;
+
+
+// Most samples handed to a sample kernel at once, so it can keep its buffers on the stack.
+const int maxSampleBatch = 64;
+
+
+// How far pixels are refined by anti-aliasing.
+struct Antialiasing {
+    // samples of a pixel at most, its own one included, 1 turns anti-aliasing off
+    int maxSamples = 1;
+    // two samples differing by more loops than this, or one inside the set and one
+    // outside, mean the pixel isn't uniform
+    int threshold = 2;
+};
+
+
+// How many pixels anti-aliasing refined and how many extra samples it took.
+struct AntialiasStats {
+    long refinedPixels;
+    long samples;
+};
+
+
+// Adaptive supersampling of a frame that is already colored. Only pixels whose loops
+// differ from one of their 8 neighbours by more than the threshold are refined: they get
+// a few extra samples jittered inside the pixel first, and all the rest up to the max
+// samples only if those don't agree with the pixel's own one. The color of a refined
+// pixel is the average color of all its samples. The loops are left alone, so the frame
+// can still be continued or colored again. Once cancel is set, no more pixels are
+// refined; it may be nullptr if that can't happen.
+void antialias(ThreadPool *pool, const std::vector<int> &loops, int width, int height,
+               const ColorTable *colors, const Antialiasing *settings,
+               const SampleKernel &sample, FrameBuffer *frameBuffer, AntialiasStats *stats,
+               const std::atomic<bool> *cancel);
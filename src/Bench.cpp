@@ -0,0 +1,203 @@
+#include "Bench.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <math.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Render.hpp"
+
+
+// One view that is benchmarked.
+struct Scene {
+    const char* name;
+    // center and width of the view, nullptr for the start view from -2.5 + i to 1 - i
+    const char* real;
+    const char* imag;
+    const char* span;
+    int maxI;
+};
+
+
+// The whole set, the seahorse valley auto zoom goes into at three depths that need
+// float, double and double-double, and a view full of bulbs whose inside isn't caught
+// by the cardioid and bulb checks.
+static const Scene scenes[] = {
+    {"start", nullptr, nullptr, nullptr, 1000},
+    {"seahorse-1e-2", "-0.7435862898659100", "0.1318763829122250", "1e-2", 1000},
+    {"seahorse-1e-6", "-0.7435862898659100", "0.1318763829122250", "1e-6", 3000},
+    {"seahorse-1e-11", "-0.7435862898659100", "0.1318763829122250", "1e-11", 1000},
+    {"interior", "-0.12", "0.9", "0.5", 5000},
+};
+const int benchWidth = 960;
+const int benchHeight = 540;
+
+
+// Seconds since start.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// Name of the CPU, to tell results of different machines apart.
+static std::string cpuName() {
+    std::ifstream cpuInfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuInfo, line)) {
+        if (line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos) {
+            return line.substr(line.find(':') + 2);
+        }
+    }
+    return "unknown";
+}
+
+
+// The text as the inside of a JSON string, with quotes, backslashes and control
+// characters escaped.
+static std::string jsonEscaped(const std::string& text) {
+    std::ostringstream escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            escaped << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                    << static_cast<int>(c);
+        } else {
+            escaped << c;
+        }
+    }
+    return escaped.str();
+}
+
+
+// Mean and sample standard deviation of the values.
+static void meanAndDeviation(const std::vector<double>& values, double* mean,
+                             double* deviation) {
+    double sum = 0;
+    for (double value : values) {
+        sum += value;
+    }
+    (*mean) = sum / values.size();
+    double squares = 0;
+    for (double value : values) {
+        squares += (value - *mean) * (value - *mean);
+    }
+    (*deviation) = values.size() > 1 ? sqrt(squares / (values.size() - 1)) : 0;
+}
+
+
+// Print the numbers as a JSON array.
+static void printArray(const std::vector<double>& values) {
+    std::cout << "[";
+    for (size_t i = 0; i < values.size(); ++i) {
+        std::cout << (i > 0 ? ", " : "") << values[i];
+    }
+    std::cout << "]";
+}
+
+
+// Render the scene once from scratch, so nothing of an earlier frame is reused, and add
+// up the loops of all pixels. Pixels inside the set count max loops, even when the
+// interior checks found them early, so the count is the same for every kernel and option
+// and loops per second compare the work a frame stands for.
+static long long renderScene(ThreadPool* pool, const Options* options,
+                             const Viewport* viewport, int maxI, Precision precision,
+                             std::vector<int>* iterations, const ColorTable* colorTable,
+                             FrameBuffer* frameBuffer) {
+    LastFrame lastFrame;
+    FrameStats stats;
+    divideAndConquer(pool, viewport, benchWidth, benchHeight, maxI, options->interiorChecks,
+                     &options->rowKernels, precision, options->seriesApproximation,
+                     options->subdivision, nullptr, iterations, &lastFrame, colorTable,
+                     frameBuffer, &stats);
+    long long loops = 0;
+    for (int pixelLoops : *iterations) {
+        loops += std::min(pixelLoops, maxI);
+    }
+    return loops;
+}
+
+
+int runBench(const Options* options) {
+    ThreadPool pool(options->threadCount);
+    FrameBuffer frameBuffer;
+    allocFrameBuffer(&frameBuffer, benchWidth, benchHeight);
+    std::vector<int> iterations;
+    ColorTable colorTable;
+    const double pixels = static_cast<double>(benchWidth) * benchHeight;
+
+    std::cout << std::setprecision(6) << "{\n"
+              << "  \"cpu\": \"" << jsonEscaped(cpuName()) << "\",\n"
+              << "  \"threads\": " << pool.size() << ",\n"
+              << "  \"kernel\": \"" << options->rowKernels.name << "\",\n"
+              << "  \"width\": " << benchWidth << ",\n"
+              << "  \"height\": " << benchHeight << ",\n"
+              << "  \"runs\": " << options->benchRuns << ",\n"
+              << "  \"scenes\": [\n";
+    const int sceneCount = sizeof(scenes) / sizeof(scenes[0]);
+    for (int s = 0; s < sceneCount; ++s) {
+        const Scene& scene = scenes[s];
+        Viewport viewport;
+        if (scene.span) {
+            BigComplex center;
+            center.real = parseBig(scene.real);
+            center.imag = parseBig(scene.imag);
+            initViewportCentered(&viewport, &center, parseBig(scene.span), benchWidth,
+                                 benchHeight);
+        } else {
+            Complex<double> upperLeft;
+            Complex<double> lowerRight;
+            initComplex(&upperLeft, -2.5, 1.0);
+            initComplex(&lowerRight, 1.0, -1.0);
+            initViewport(&viewport, &upperLeft, &lowerRight);
+        }
+        Precision precision = options->autoPrecision
+                              ? choosePrecision(&viewport, benchWidth,
+                                                hasPerturbation(&options->rowKernels))
+                              : options->precision;
+        updateColorTable(&colorTable, &options->palettes[options->paletteIndex],
+                         scene.maxI);
+
+        renderScene(&pool, options, &viewport, scene.maxI, precision, &iterations,
+                    &colorTable, &frameBuffer);
+        std::vector<double> busyBefore = pool.busySeconds();
+        std::vector<double> seconds;
+        long long loops = 0;
+        for (int run = 0; run < options->benchRuns; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            loops = renderScene(&pool, options, &viewport, scene.maxI, precision,
+                                &iterations, &colorTable, &frameBuffer);
+            seconds.push_back(secondsSince(start));
+        }
+        // busy seconds per frame of every worker, below the frame time when it idled
+        std::vector<double> busy = pool.busySeconds();
+        for (size_t worker = 0; worker < busy.size(); ++worker) {
+            busy[worker] = (busy[worker] - busyBefore[worker]) / options->benchRuns;
+        }
+
+        double mean;
+        double deviation;
+        meanAndDeviation(seconds, &mean, &deviation);
+        const double fastest = *std::min_element(seconds.begin(), seconds.end());
+        // progress for whoever watches, the results are only complete at the end
+        std::cerr << scene.name << ": " << 1000 * mean << " ms\n";
+
+        std::cout << "    {\"name\": \"" << scene.name << "\", \"maxI\": " << scene.maxI
+                  << ", \"precision\": \"" << precisionName(precision) << "\""
+                  << ", \"iterations\": " << loops << ",\n"
+                  << "     \"seconds\": ";
+        printArray(seconds);
+        std::cout << ",\n     \"meanSeconds\": " << mean << ", \"minSeconds\": " << fastest
+                  << ", \"relativeDeviation\": " << deviation / mean << ",\n"
+                  << "     \"mpixelsPerSecond\": " << pixels / mean / 1e6
+                  << ", \"gigaIterationsPerSecond\": " << loops / mean / 1e9 << ",\n"
+                  << "     \"busySeconds\": ";
+        printArray(busy);
+        std::cout << "}" << (s + 1 < sceneCount ? "," : "") << "\n";
+    }
+    std::cout << "  ]\n}\n";
+    return 0;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include "Options.hpp"
+
+
+// Render a fixed set of scenes without a window, each at the same resolution and max
+// loops no matter the options, and print how fast that went as JSON, to compare builds
+// and CPUs. Every scene is rendered once to warm up and then --bench-runs times from
+// scratch. The kernel, precision, thread and rendering options still apply, so their
+// effect can be measured too. Returns the exit code.
+int runBench(const Options* options);
@@ -0,0 +1,92 @@
+#include "Budget.hpp"
+#include <algorithm>
+#include <cmath>
+
+
+// The escaping pixels are counted in this many bins evenly spread over max loops.
+const int histogramBins = 16;
+
+
+// Share of the escaping pixels that may need more loops than the ones found to be used.
+const double unusedShare = 1e-4;
+
+
+// Escape histogram of a row and its capped pixels next to ones that escaped late.
+struct RowCounts {
+    long bins[histogramBins];
+    long smeared;
+};
+
+
+// Whether the pixel at index escaped, but only in the top quarter of max loops.
+static bool escapedLate(const std::vector<int>& loops, size_t index, int maxI) {
+    return loops[index] < maxI && loops[index] >= maxI - maxI / 4;
+}
+
+
+// Count the escaping pixels of row y by bin and the pixels that ran into max loops right
+// next to one that escaped late.
+static RowCounts countRow(const std::vector<int>& loops, int width, int height, int y,
+                          int maxI) {
+    RowCounts counts = {};
+    const size_t row = static_cast<size_t>(y) * width;
+    for (int x = 0; x < width; ++x) {
+        const int own = loops[row + x];
+        if (own < maxI) {
+            counts.bins[static_cast<long>(own) * histogramBins / maxI]++;
+            continue;
+        }
+        if ((x > 0 && escapedLate(loops, row + x - 1, maxI))
+            || (x + 1 < width && escapedLate(loops, row + x + 1, maxI))
+            || (y > 0 && escapedLate(loops, row + x - width, maxI))
+            || (y + 1 < height && escapedLate(loops, row + x + width, maxI))) {
+            counts.smeared++;
+        }
+    }
+    return counts;
+}
+
+
+// The least max loops for the viewport: minI plus loopsPerOctave for every halving of
+// the view from 4 wide.
+static long depthFloor(const Viewport* viewport, int width, int minI) {
+    const double viewExp = pixelSpacingExp(viewport, width) + std::log2(width);
+    return minI + static_cast<long>(loopsPerOctave * std::max(0.0, 2 - viewExp));
+}
+
+
+int nextMaxI(ThreadPool* pool, const IterationBudget* budget, const std::vector<int>& loops,
+             int width, int height, int maxI, int minI, const Viewport* next) {
+    std::vector<RowCounts> rows(height);
+    pool->run(height, [&](int y, int worker) {
+        rows[y] = countRow(loops, width, height, y, maxI);
+    }, "budget");
+    long bins[histogramBins] = {};
+    long smeared = 0;
+    long escaped = 0;
+    for (const RowCounts& row : rows) {
+        for (int bin = 0; bin < histogramBins; ++bin) {
+            bins[bin] += row.bins[bin];
+            escaped += row.bins[bin];
+        }
+        smeared += row.smeared;
+    }
+
+    long target = maxI;
+    if (100.0 * smeared > budget->capPercent * width * height) {
+        target = maxI + std::max(1, maxI / 2);
+    } else {
+        // the loops almost every escaping pixel stayed under, to the next bin edge
+        long beyond = 0;
+        int used = histogramBins;
+        while (used > 0 && beyond + bins[used - 1] <= unusedShare * escaped) {
+            beyond += bins[--used];
+        }
+        const long usedLoops = static_cast<long>(maxI) * used / histogramBins;
+        if (2 * used <= histogramBins) {
+            target = 2 * usedLoops;
+        }
+    }
+    target = std::max(target, depthFloor(next, width, minI));
+    return static_cast<int>(std::min<long>(target, budget->ceiling));
+}
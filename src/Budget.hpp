@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include "ThreadPool.hpp"
+#include "Viewport.hpp"
+
+
+// How max loops follow the frames of a zoom when they are picked automatically.
+struct IterationBudget {
+    // max loops are set by nextMaxI() after every frame instead of staying put
+    bool adaptive = false;
+    // max loops never go above this
+    int ceiling = 100000;
+    // max loops go up while more than this percentage of the pixels run into them right
+    // next to pixels that only escaped late
+    double capPercent = 0.1;
+};
+
+
+// Extra max loops for every halving of the view from a 4 wide one. The loops escaping
+// pixels need grow about linearly with the zoom depth, so this is what a frame needs at
+// least, whatever the frame before looked like.
+const int loopsPerOctave = 25;
+
+
+// The max loops for the frame of the next viewport, after the frame with the given loops
+// was rendered with maxI. They go up by half while too many pixels run into max loops
+// next to pixels that escaped in the top quarter of them, which is what under-iterated
+// frames look like: black smears around the edges of the set. Pixels inside the set reach
+// max loops as well, but their neighbours escape much earlier, so they don't count. Max
+// loops come down to twice what almost every escaping pixel needed when the top half of
+// them went unused. Never goes below minI plus loopsPerOctave for every halving of the
+// view, or above the ceiling of the budget.
+int nextMaxI(ThreadPool* pool, const IterationBudget* budget, const std::vector<int>& loops,
+             int width, int height, int maxI, int minI, const Viewport* next);
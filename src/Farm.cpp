@@ -0,0 +1,467 @@
+#include "Farm.hpp"
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "Render.hpp"
+#include "FrameWriter.hpp"
+
+
+// Everything a worker needs to render a frame, apart from its kernel and threads. Frames
+// are numbered from 1 like the saved ones.
+struct FarmJob {
+    int frame = 0;
+    int width = 0;
+    int height = 0;
+    int maxI = 0;
+    Precision precision = PrecisionDouble;
+    bool interiorChecks = true;
+    bool subdivision = false;
+    bool seriesApproximation = false;
+    Fractal fractal = FractalMandelbrot;
+    int power = 2;
+    BigComplex julia;
+    Viewport viewport;
+};
+
+
+// A worker process connected to the coordinator.
+struct FarmWorker {
+    int socket = -1;
+    std::string name;
+    // frame it is rendering, 0 while idle
+    int frame = 0;
+    long frames = 0;
+};
+
+
+// Seconds since start.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// Send all bytes, however many calls of send() that takes. A peer that went away gives
+// false instead of SIGPIPE.
+static bool sendAll(int socket, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t sent = send(socket, bytes, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        bytes += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+
+// Receive exactly size bytes. Returns false if the peer went away before.
+static bool receiveAll(int socket, void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t received = recv(socket, bytes, size, 0);
+        if (received <= 0) {
+            return false;
+        }
+        bytes += received;
+        size -= received;
+    }
+    return true;
+}
+
+
+// Messages go as their size followed by their bytes. An empty message tells a worker to
+// quit. Both ends are expected to have the same byte order.
+static bool sendMessage(int socket, const void* data, uint64_t size) {
+    return sendAll(socket, &size, sizeof(size)) && sendAll(socket, data, size);
+}
+
+
+// Receive a message, at most maxSize bytes big so garbage can't make it allocate all
+// memory.
+static bool receiveMessage(int socket, uint64_t maxSize, std::vector<char>* message) {
+    uint64_t size;
+    if (!receiveAll(socket, &size, sizeof(size)) || size > maxSize) {
+        return false;
+    }
+    message->resize(size);
+    return receiveAll(socket, message->data(), size);
+}
+
+
+// Write the job as text, with the viewport and the c of Julia sets exact to the last bit.
+static std::string jobText(const FarmJob* job) {
+    std::ostringstream text;
+    text << job->frame << " " << job->width << " " << job->height << " " << job->maxI << " "
+         << precisionName(job->precision) << " " << job->interiorChecks << " "
+         << job->subdivision << " " << job->seriesApproximation << " " << job->fractal << " "
+         << job->power << "\n";
+    writeViewport(text, &job->viewport);
+    writeBig(text, job->julia.real);
+    text << "\n";
+    writeBig(text, job->julia.imag);
+    text << "\n";
+    return text.str();
+}
+
+
+// Read a job written by jobText(). Returns false if the text isn't one.
+static bool readJob(const std::string& text, FarmJob* job) {
+    std::istringstream in(text);
+    std::string precision;
+    int fractal;
+    if (!(in >> job->frame >> job->width >> job->height >> job->maxI >> precision
+          >> job->interiorChecks >> job->subdivision >> job->seriesApproximation >> fractal
+          >> job->power)) {
+        return false;
+    }
+    job->fractal = static_cast<Fractal>(fractal);
+    return job->width > 0 && job->height > 0 && job->maxI > 0
+           && (fractal == FractalMandelbrot || fractal == FractalJulia)
+           && job->power >= minPower && job->power <= maxPower
+           && findPrecision(precision.c_str(), &job->precision)
+           && readViewport(in, &job->viewport) && readBig(in, &job->julia.real)
+           && readBig(in, &job->julia.imag);
+}
+
+
+// Listen for workers on the TCP port of all interfaces. Exits with an error if the port
+// can't be used.
+static int listenOn(int port) {
+    int listener = socket(AF_INET6, SOCK_STREAM, 0);
+    int on = 1;
+    int off = 0;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    // IPv4 workers are welcome too
+    setsockopt(listener, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    sockaddr_in6 address = {};
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_any;
+    address.sin6_port = htons(port);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address),
+                             sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        std::cout << "Could not listen for workers on port " << port << ".\n";
+        exit(1);
+    }
+    return listener;
+}
+
+
+// Connect to host:port. The coordinator may not be up yet when a worker starts, so it
+// keeps trying for a few seconds. Exits with an error if it never gets through.
+static int connectTo(const std::string& address) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        std::cout << "The coordinator has to be given as HOST:PORT.\n";
+        exit(1);
+    }
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    for (int attempt = 0; attempt < 50; ++attempt) {
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) == 0) {
+            for (addrinfo* candidate = addresses; candidate; candidate = candidate->ai_next) {
+                int connection = socket(candidate->ai_family, candidate->ai_socktype,
+                                        candidate->ai_protocol);
+                if (connection >= 0
+                    && connect(connection, candidate->ai_addr, candidate->ai_addrlen) == 0) {
+                    freeaddrinfo(addresses);
+                    return connection;
+                }
+                if (connection >= 0) {
+                    close(connection);
+                }
+            }
+            freeaddrinfo(addresses);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    std::cout << "Could not connect to the coordinator at " << address << ".\n";
+    exit(1);
+}
+
+
+// Hand the next frame to an idle worker: one that was lost on the way first, otherwise
+// the next one of the zoom, as long as not too many finished frames would pile up
+// waiting for an earlier one. Returns false if there is nothing to hand out right now.
+static bool nextJob(const Options* options, std::deque<int>* retries, int maxAhead,
+                    int nextSave, int* nextFrame, Viewport* viewport,
+                    std::map<int, FarmJob>* jobs, int* frame) {
+    if (!retries->empty()) {
+        (*frame) = retries->front();
+        retries->pop_front();
+        return true;
+    }
+    if (*nextFrame > options->maxFrames || *nextFrame - nextSave >= maxAhead) {
+        return false;
+    }
+    FarmJob& job = (*jobs)[*nextFrame];
+    job.frame = *nextFrame;
+    job.width = options->width;
+    job.height = options->height;
+    job.maxI = options->maxI;
+    job.precision = options->autoPrecision
+                    ? choosePrecision(viewport, options->width,
+                                      hasPerturbation(&options->rowKernels))
+                    : options->precision;
+    job.interiorChecks = options->interiorChecks;
+    job.subdivision = options->subdivision;
+    job.seriesApproximation = options->seriesApproximation;
+    job.fractal = options->fractal;
+    job.power = options->power;
+    job.julia = options->julia;
+    job.viewport = *viewport;
+    zoomInAuto(&options->target, viewport, options->width, options->zoomFactor);
+    (*frame) = (*nextFrame)++;
+    return true;
+}
+
+
+// Hang up on a worker and put its frame, if any, in front of the queue again.
+static void dropWorker(std::vector<FarmWorker>* workers, size_t index,
+                       std::deque<int>* retries, long* retried) {
+    FarmWorker& worker = (*workers)[index];
+    if (worker.frame > 0) {
+        std::cout << "Lost worker " << worker.name << ", frame " << worker.frame
+                  << " goes to another one.\n";
+        retries->push_front(worker.frame);
+        (*retried)++;
+    } else {
+        std::cout << "Worker " << worker.name << " left.\n";
+    }
+    close(worker.socket);
+    workers->erase(workers->begin() + index);
+}
+
+
+int runFarmCoordinator(const Options* options) {
+    if (options->maxFrames < 1) {
+        std::cout << "A render farm needs -m FRAMES.\n";
+        return 1;
+    }
+    const int width = options->width;
+    const int height = options->height;
+    const size_t pixels = static_cast<size_t>(width) * height;
+    int listener = listenOn(options->farmPort);
+    std::cout << "Waiting for workers on port " << options->farmPort << ".\n";
+
+    // the coordinator only colors, but that goes faster on all cores too
+    ThreadPool pool(options->threadCount);
+    FrameBuffer frameBuffer;
+    allocFrameBuffer(&frameBuffer, width, height);
+    ColorTable colorTable;
+    updateColorTable(&colorTable, &options->palettes[options->paletteIndex], options->maxI);
+    FrameWriter frameWriter(options->encoders, options->pngLevel);
+    const int digits = frameDigits(options->maxFrames);
+    std::unique_ptr<FrameWriter> streamWriter;
+    if (!options->streamPath.empty()) {
+        streamWriter.reset(new FrameWriter(options->streamFormat,
+                                           openStream(options->streamPath),
+                                           options->encoders));
+    }
+
+    std::vector<FarmWorker> workers;
+    // frames handed out or waiting to be handed out again, by number
+    std::map<int, FarmJob> jobs;
+    std::deque<int> retries;
+    // loops of finished frames that wait for an earlier one before they can be saved
+    std::map<int, std::vector<int>> finished;
+    Viewport viewport = options->viewport;
+    int nextFrame = 1;
+    int nextSave = 1;
+    long retried = 0;
+    std::vector<char> message;
+    auto start = std::chrono::steady_clock::now();
+
+    while (nextSave <= options->maxFrames) {
+        // a few frames per worker may be ahead of the next one saved
+        const int maxAhead = 4 * std::max<int>(1, workers.size());
+        for (size_t i = 0; i < workers.size(); ++i) {
+            int frame;
+            if (workers[i].frame > 0
+                || !nextJob(options, &retries, maxAhead, nextSave, &nextFrame, &viewport,
+                            &jobs, &frame)) {
+                continue;
+            }
+            workers[i].frame = frame;
+            std::string text = jobText(&jobs[frame]);
+            if (!sendMessage(workers[i].socket, text.data(), text.size())) {
+                dropWorker(&workers, i, &retries, &retried);
+                --i;
+            }
+        }
+
+        std::vector<pollfd> waiting = {{listener, POLLIN, 0}};
+        for (const FarmWorker& worker : workers) {
+            waiting.push_back({worker.socket, POLLIN, 0});
+        }
+        if (poll(waiting.data(), waiting.size(), -1) < 0) {
+            continue;
+        }
+
+        // results, or a worker that went away
+        for (size_t i = waiting.size() - 1; i >= 1; --i) {
+            if (waiting[i].revents == 0) {
+                continue;
+            }
+            FarmWorker& worker = workers[i - 1];
+            // anything but the loops of the frame it was given means it is gone or broken
+            const size_t resultSize = sizeof(int) * (pixels + 1);
+            bool received = worker.frame > 0
+                            && receiveMessage(worker.socket, resultSize, &message)
+                            && message.size() == resultSize;
+            int frame = 0;
+            if (received) {
+                std::memcpy(&frame, message.data(), sizeof(int));
+            }
+            if (!received || frame != worker.frame) {
+                dropWorker(&workers, i - 1, &retries, &retried);
+                continue;
+            }
+            std::vector<int>& loops = finished[frame];
+            loops.resize(pixels);
+            std::memcpy(loops.data(), message.data() + sizeof(int), sizeof(int) * pixels);
+            jobs.erase(frame);
+            worker.frame = 0;
+            worker.frames++;
+        }
+
+        if (waiting[0].revents != 0) {
+            sockaddr_storage address;
+            socklen_t addressSize = sizeof(address);
+            int connection = accept(listener, reinterpret_cast<sockaddr*>(&address),
+                                    &addressSize);
+            if (connection >= 0) {
+                int on = 1;
+                setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                char host[NI_MAXHOST] = "?";
+                char port[NI_MAXSERV] = "?";
+                getnameinfo(reinterpret_cast<sockaddr*>(&address), addressSize, host,
+                            sizeof(host), port, sizeof(port),
+                            NI_NUMERICHOST | NI_NUMERICSERV);
+                FarmWorker worker;
+                worker.socket = connection;
+                worker.name = std::string(host) + ":" + port;
+                workers.push_back(worker);
+                std::cout << "Worker " << worker.name << " joined.\n";
+            }
+        }
+
+        // color and save whatever is next in order
+        for (auto next = finished.find(nextSave); next != finished.end();
+             next = finished.find(nextSave)) {
+            const std::vector<int>& loops = next->second;
+            pool.run(height, [&](int y, int worker) {
+                colorize(&colorTable, loops.data() + static_cast<size_t>(y) * width, width,
+                         pixelAt(&frameBuffer, 0, y));
+            }, "colorize");
+            if (options->saveFrames) {
+                frameWriter.save(&frameBuffer, frameFilename(nextSave, digits));
+            }
+            if (streamWriter) {
+                streamWriter->save(&frameBuffer);
+            }
+            finished.erase(next);
+            nextSave++;
+        }
+    }
+
+    // an empty message sends the workers home
+    for (const FarmWorker& worker : workers) {
+        sendMessage(worker.socket, nullptr, 0);
+        close(worker.socket);
+    }
+    close(listener);
+    frameWriter.flush();
+    if (streamWriter) {
+        streamWriter->flush();
+    }
+
+    double totalSeconds = secondsSince(start);
+    std::cout << std::fixed << std::setprecision(3) << "Rendered " << options->maxFrames
+              << " frames of " << width << "x" << height << " in " << totalSeconds << " s: "
+              << options->maxFrames / totalSeconds << " frames/s, " << retried
+              << " frames handed out again\n";
+    for (const FarmWorker& worker : workers) {
+        std::cout << "Worker " << worker.name << ": " << worker.frames << " frames\n";
+    }
+    return 0;
+}
+
+
+int runFarmWorker(const Options* options) {
+    int connection = connectTo(options->farmAddress);
+    int on = 1;
+    setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    ThreadPool pool(options->threadCount);
+    FrameBuffer frameBuffer;
+    std::vector<int> iterations;
+    LastFrame lastFrame;
+    FrameStats stats;
+    // frames are colored by the coordinator, this only keeps divideAndConquer happy
+    Palette palette = builtinPalette();
+    ColorTable colorTable;
+    std::vector<char> message;
+    std::vector<int> result;
+    long frames = 0;
+
+    while (true) {
+        if (!receiveMessage(connection, 1 << 20, &message)) {
+            std::cout << "Lost the coordinator.\n";
+            close(connection);
+            return 1;
+        }
+        if (message.empty()) {
+            break;
+        }
+        FarmJob job;
+        if (!readJob(std::string(message.begin(), message.end()), &job)) {
+            std::cout << "Got a frame from the coordinator that makes no sense.\n";
+            close(connection);
+            return 1;
+        }
+
+        if (frameBuffer.width != job.width || frameBuffer.height != job.height) {
+            allocFrameBuffer(&frameBuffer, job.width, job.height);
+        }
+        updateColorTable(&colorTable, &palette, job.maxI);
+        // the fractal is the coordinator's, the instruction set the worker's own
+        RowKernels rowKernels = options->rowKernels;
+        selectFractal(&rowKernels, job.fractal, job.power, &job.julia);
+        divideAndConquer(&pool, &job.viewport, job.width, job.height, job.maxI,
+                         job.interiorChecks, &rowKernels, job.precision,
+                         job.seriesApproximation, job.subdivision, nullptr, &iterations,
+                         &lastFrame, &colorTable, &frameBuffer, &stats);
+
+        // the frame number, then the loops of every pixel
+        result.resize(iterations.size() + 1);
+        result[0] = job.frame;
+        std::copy(iterations.begin(), iterations.end(), result.begin() + 1);
+        if (!sendMessage(connection, result.data(), sizeof(int) * result.size())) {
+            std::cout << "Lost the coordinator.\n";
+            close(connection);
+            return 1;
+        }
+        frames++;
+    }
+    close(connection);
+    std::cout << "Rendered " << frames << " frames for the coordinator.\n";
+    return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "Options.hpp"
+
+
+// Render an auto zoom of -m frames on worker processes, on this machine or others. The
+// coordinator works out the viewport of every frame exactly like headless rendering
+// does, hands whole frames to the workers connected to its TCP port, colors the loops
+// they send back and saves (-s) or streams the frames strictly in order. A frame whose
+// worker goes away before it is done is handed to another one. Workers can connect and
+// leave at any time. Returns the exit code.
+int runFarmCoordinator(const Options* options);
+
+
+// Connect to the coordinator at host:port and render frames for it until it is done.
+// Only the kernel (-k) and the amount of threads (-j) are taken from the own options,
+// everything else comes with each frame. Returns the exit code.
+int runFarmWorker(const Options* options);
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+
+// Alignment of the frame buffer, one cache line.
+const size_t frameBufferAlignment = 64;
+
+
+// All pixels of a frame as one contiguous block of RGBA bytes, row by row without any
+// padding, which is exactly the layout sf::Texture::update() and sf::Image expect. It is
+// allocated once and the workers write their tiles straight into it.
+struct FrameBuffer {
+    int width = 0;
+    int height = 0;
+    std::unique_ptr<uint8_t, decltype(&std::free)> pixels{nullptr, &std::free};
+};
+
+
+// (Re)allocate the frame buffer for width x height pixels, cleared to black.
+inline void allocFrameBuffer(FrameBuffer *buffer, int width, int height) {
+    size_t size = static_cast<size_t>(width) * height * 4;
+    // aligned_alloc wants the size to be a multiple of the alignment
+    size_t rounded = (size + frameBufferAlignment - 1) / frameBufferAlignment
+                     * frameBufferAlignment;
+    buffer->pixels.reset(static_cast<uint8_t*>(std::aligned_alloc(frameBufferAlignment,
+                                                                  rounded)));
+    buffer->width = width;
+    buffer->height = height;
+    for (size_t i = 0; i < size; i += 4) {
+        buffer->pixels.get()[i] = 0;
+        buffer->pixels.get()[i + 1] = 0;
+        buffer->pixels.get()[i + 2] = 0;
+        buffer->pixels.get()[i + 3] = 255;
+    }
+}
+
+
+// Pointer to the first byte of pixel (x, y).
+inline uint8_t* pixelAt(FrameBuffer *buffer, int x, int y) {
+    return buffer->pixels.get() + (static_cast<size_t>(y) * buffer->width + x) * 4;
+}
+
+
+// Copy all pixels of one frame buffer into another one of the same size.
+inline void copyFrameBuffer(const FrameBuffer *from, FrameBuffer *to) {
+    std::memcpy(to->pixels.get(), from->pixels.get(),
+                static_cast<size_t>(from->width) * from->height * 4);
+}
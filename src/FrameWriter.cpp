@@ -0,0 +1,137 @@
+#include "FrameWriter.hpp"
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+
+FrameWriter::FrameWriter(int encoders, int level)
+    : format(FramePng), stream(nullptr), level(std::min(9, std::max(0, level))),
+      capacity(2 * static_cast<size_t>(std::max(1, encoders))) {
+    startEncoders(encoders);
+}
+
+
+FrameWriter::FrameWriter(FrameFormat format, FILE* stream, int encoders)
+    : format(format), stream(stream), level(0),
+      capacity(2 * static_cast<size_t>(std::max(1, encoders))) {
+    startEncoders(encoders);
+}
+
+
+void FrameWriter::startEncoders(int encoders) {
+    for (int i = 0; i < std::max(1, encoders); ++i) {
+        threads.emplace_back(&FrameWriter::encoderLoop, this);
+    }
+}
+
+
+FrameWriter::~FrameWriter() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queued.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (stream && stream != stdout) {
+        std::fclose(stream);
+    }
+}
+
+
+// Only the copy itself happens without the mutex. There is a single caller, so frames
+// are still queued in the order of their sequence numbers.
+void FrameWriter::save(const FrameBuffer* frameBuffer, const std::string& filename) {
+    Frame frame;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        written.wait(lock, [this] { return pending < capacity; });
+        pending++;
+        if (!spare.empty()) {
+            frame.frameBuffer = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+
+    if (frame.frameBuffer.width != frameBuffer->width
+        || frame.frameBuffer.height != frameBuffer->height) {
+        allocFrameBuffer(&frame.frameBuffer, frameBuffer->width, frameBuffer->height);
+    }
+    copyFrameBuffer(frameBuffer, &frame.frameBuffer);
+    frame.filename = filename;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        frame.sequence = nextSequence++;
+        frames.push_back(std::move(frame));
+    }
+    queued.notify_one();
+}
+
+
+void FrameWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    written.wait(lock, [this] { return pending == 0; });
+}
+
+
+// Encode the frame into the bytes that are written for it.
+bool FrameWriter::encode(const Frame* frame, std::vector<uint8_t>* bytes) const {
+    switch (format) {
+        case FramePng:
+            return encodePng(&frame->frameBuffer, level, bytes);
+        case FrameY4m:
+            encodeY4m(&frame->frameBuffer, frame->sequence == 0, bytes);
+            return true;
+        case FrameRgb:
+            encodeRgb(&frame->frameBuffer, bytes);
+            return true;
+    }
+    return false;
+}
+
+
+// Encode the oldest waiting frame, then wait for all frames before it to be written
+// before writing it. The encoded bytes are kept from frame to frame, so their memory is
+// only allocated once per encoder.
+void FrameWriter::encoderLoop() {
+    std::vector<uint8_t> bytes;
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queued.wait(lock, [this] { return stopping || !frames.empty(); });
+            if (frames.empty()) {
+                return;
+            }
+            frame = std::move(frames.front());
+            frames.pop_front();
+        }
+
+        bool encoded = encode(&frame, &bytes);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            written.wait(lock, [&] { return nextWrite == frame.sequence; });
+        }
+        // all other encoders wait for their turn until nextWrite moves on
+        if (!encoded || !(stream ? writeStream(stream, bytes)
+                                 : writeFile(frame.filename, bytes))) {
+            if (stream) {
+                std::cout << "Could not stream frame " << frame.sequence + 1 << "\n";
+            } else {
+                std::cout << "Could not save " << frame.filename << "\n";
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            nextWrite++;
+            pending--;
+            spare.push_back(std::move(frame.frameBuffer));
+        }
+        written.notify_all();
+    }
+}
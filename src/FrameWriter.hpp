@@ -0,0 +1,70 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameBuffer.hpp"
+#include "Output.hpp"
+
+
+// Saves frames as png, or streams them as video, on threads of its own, so the next frame
+// renders while the last ones are encoded. Every encoder encodes one frame at a time, but
+// the frames are written in the order they were handed over. At most two frames per
+// encoder are held at once; handing over more waits until the oldest one is written, so
+// memory stays bounded when rendering is faster than encoding.
+class FrameWriter {
+public:
+    // Save png files with encoders threads compressing at the zlib level, 0 to 9.
+    FrameWriter(int encoders, int level);
+    // Stream frames of the format one after the other into stream, which is closed once
+    // every frame is written.
+    FrameWriter(FrameFormat format, FILE* stream, int encoders);
+    // Writes every frame handed over before returning.
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    // Copy the frame buffer to be saved as filename, or as the next frame of the stream.
+    // Returns right away unless too many frames are still waiting.
+    void save(const FrameBuffer* frameBuffer, const std::string& filename = "");
+
+    // Wait until every frame handed over so far is written.
+    void flush();
+
+private:
+    struct Frame {
+        // position in the order the frames were handed over
+        uint64_t sequence = 0;
+        std::string filename;
+        FrameBuffer frameBuffer;
+    };
+
+    void startEncoders(int encoders);
+    void encoderLoop();
+    bool encode(const Frame* frame, std::vector<uint8_t>* bytes) const;
+
+    const FrameFormat format;
+    // nullptr for png files
+    FILE* const stream;
+    const int level;
+    const size_t capacity;
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable written;
+    // waiting for an encoder
+    std::deque<Frame> frames;
+    // frame buffers of written frames, to copy the next ones into
+    std::vector<FrameBuffer> spare;
+    // handed over but not written yet
+    size_t pending = 0;
+    uint64_t nextSequence = 0;
+    uint64_t nextWrite = 0;
+    bool stopping = false;
+    // started last, once everything above is set up
+    std::vector<std::thread> threads;
+};
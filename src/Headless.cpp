@@ -0,0 +1,180 @@
+#include "Headless.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "Render.hpp"
+#include "Output.hpp"
+#include "FrameWriter.hpp"
+#include "Trace.hpp"
+#include "TileCache.hpp"
+
+
+// Seconds since start.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+int runHeadless(const Options* options) {
+    if (options->maxFrames < 1) {
+        std::cout << "Headless rendering needs -m FRAMES.\n";
+        return 1;
+    }
+
+    const int width = options->width;
+    const int height = options->height;
+    // declared before the pool, so it is only written once the workers are gone
+    std::unique_ptr<Trace> trace;
+    if (!options->tracePath.empty()) {
+        trace.reset(new Trace(options->tracePath));
+    }
+    ThreadPool pool(options->threadCount);
+    pool.setTrace(trace.get());
+    Viewport viewport = options->viewport;
+    Precision precision = options->precision;
+    Reprojection reprojection;
+    reprojection.tolerance = options->tolerance;
+    FrameBuffer frameBuffer;
+    allocFrameBuffer(&frameBuffer, width, height);
+    std::vector<int> iterations;
+    LastFrame lastFrame;
+    ColorTable colorTable;
+    int maxI = options->maxI;
+    FrameStats stats;
+    FrameWriter frameWriter(options->encoders, options->pngLevel);
+    const int digits = frameDigits(options->maxFrames);
+    std::unique_ptr<FrameWriter> streamWriter;
+    if (!options->streamPath.empty()) {
+        streamWriter.reset(new FrameWriter(options->streamFormat,
+                                           openStream(options->streamPath),
+                                           options->encoders));
+    }
+
+    std::unique_ptr<TileCache> cache;
+    if (!options->cachePath.empty()) {
+        cache.reset(new TileCache(options->cachePath, options->cacheMegabytes << 20));
+    }
+
+    double renderSeconds = 0;
+    double computeMs = 0;
+    double colorizeMs = 0;
+    double saveSeconds = 0;
+    long reusedPixels = 0;
+    long mirroredPixels = 0;
+    long cachedTiles = 0;
+    long computedTiles = 0;
+    double antialiasMs = 0;
+    long antialiasedPixels = 0;
+    long antialiasSamples = 0;
+    int lowestMaxI = maxI;
+    int highestMaxI = maxI;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 1; frame <= options->maxFrames; ++frame) {
+        if (options->autoPrecision) {
+            precision = choosePrecision(&viewport, width,
+                                        hasPerturbation(&options->rowKernels));
+        }
+        updateColorTable(&colorTable, &options->palettes[options->paletteIndex], maxI);
+        lowestMaxI = std::min(lowestMaxI, maxI);
+        highestMaxI = std::max(highestMaxI, maxI);
+        auto renderStart = std::chrono::steady_clock::now();
+        double traceStart = trace ? trace->now() : 0;
+        if (!cache || !renderCached(&pool, cache.get(), &viewport, width, height,
+                                    maxI, options->interiorChecks,
+                                    &options->rowKernels, &iterations, &lastFrame,
+                                    &colorTable, &frameBuffer, &stats, nullptr)) {
+            divideAndConquer(&pool, &viewport, width, height, maxI,
+                             options->interiorChecks, &options->rowKernels, precision,
+                             options->seriesApproximation, options->subdivision,
+                             options->reuse ? &reprojection : nullptr, &iterations,
+                             &lastFrame, &colorTable, &frameBuffer, &stats);
+        }
+        antialiasFrame(&pool, &viewport, width, height, maxI,
+                       options->interiorChecks, &options->rowKernels, precision,
+                       options->seriesApproximation, &options->antialiasing, iterations,
+                       &colorTable, &frameBuffer, &stats, nullptr);
+        renderSeconds += secondsSince(renderStart);
+        computeMs += stats.computeMs;
+        colorizeMs += stats.colorizeMs;
+        reusedPixels += stats.reusedPixels;
+        mirroredPixels += stats.mirroredPixels;
+        cachedTiles += stats.cachedTiles;
+        computedTiles += stats.computedTiles;
+        antialiasMs += stats.antialiasMs;
+        antialiasedPixels += stats.antialiasedPixels;
+        antialiasSamples += stats.antialiasSamples;
+        if (trace) {
+            traceFrame(trace.get(), traceMainLane, traceStart, trace->now(), &stats);
+        }
+
+        if (options->saveFrames || streamWriter) {
+            auto saveStart = std::chrono::steady_clock::now();
+            traceStart = trace ? trace->now() : 0;
+            if (options->saveFrames) {
+                frameWriter.save(&frameBuffer, frameFilename(frame, digits));
+            }
+            if (streamWriter) {
+                streamWriter->save(&frameBuffer);
+            }
+            saveSeconds += secondsSince(saveStart);
+            if (trace) {
+                trace->event("save", traceMainLane, traceStart, trace->now());
+            }
+        }
+        zoomInAuto(&options->target, &viewport, width, options->zoomFactor);
+        if (options->budget.adaptive) {
+            maxI = nextMaxI(&pool, &options->budget, iterations, width, height, maxI,
+                            options->maxI, &viewport);
+        }
+    }
+    // the last frames are still being compressed
+    auto flushStart = std::chrono::steady_clock::now();
+    frameWriter.flush();
+    if (streamWriter) {
+        streamWriter->flush();
+    }
+    saveSeconds += secondsSince(flushStart);
+    double totalSeconds = secondsSince(start);
+
+    const int frames = options->maxFrames;
+    const double pixels = static_cast<double>(width) * height * frames;
+    std::cout << std::fixed << std::setprecision(3)
+              << "Rendered " << frames << " frames of " << width << "x" << height << " in "
+              << totalSeconds << " s: " << frames / totalSeconds << " frames/s, "
+              << pixels / totalSeconds / 1e6 << " Mpixels/s\n"
+              << "Render: " << 1000 * renderSeconds / frames << " ms/frame, "
+              << pixels / renderSeconds / 1e6 << " Mpixels/s, of which compute "
+              << computeMs / frames << " ms and colorize " << colorizeMs / frames << " ms\n";
+    if (options->saveFrames || streamWriter) {
+        std::cout << "Save: " << 1000 * saveSeconds / frames
+                  << " ms/frame waiting for the encoders\n";
+    }
+    if (options->reuse) {
+        std::cout << std::setprecision(1) << "Reused: " << 100 * reusedPixels / pixels
+                  << "% of the pixels\n";
+    }
+    if (mirroredPixels > 0) {
+        std::cout << std::setprecision(1) << "Mirrored: " << 100 * mirroredPixels / pixels
+                  << "% of the pixels\n";
+    }
+    if (options->antialiasing.maxSamples > 1) {
+        std::cout << std::setprecision(1) << "Anti-aliasing: " << antialiasMs / frames
+                  << " ms/frame, " << 100 * antialiasedPixels / pixels
+                  << "% of the pixels refined with "
+                  << static_cast<double>(antialiasSamples) / std::max(1L, antialiasedPixels)
+                  << " extra samples each\n";
+    }
+    if (cache) {
+        std::cout << "Cache: " << cachedTiles << " tiles found, " << computedTiles
+                  << " iterated, " << cache->size() << " of " << cache->capacity()
+                  << " slots used\n";
+    }
+    if (options->budget.adaptive) {
+        std::cout << "Max iterations: " << lowestMaxI << " to " << highestMaxI << "\n";
+    }
+    std::cout << "Last precision: " << precisionName(precision) << "\n";
+    return 0;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include "Options.hpp"
+
+
+// Render -m frames without a window, font or event loop, zooming from the start viewport
+// towards the target by the zoom factor after every frame, just like auto zoom does. The
+// frames go through the same compute and colorize pipeline as in the window and are
+// saved with -s. Prints the throughput at the end. Returns the exit code.
+int runHeadless(const Options* options);
@@ -0,0 +1,849 @@
+#include "Kernel.hpp"
+#include <math.h>
+#include <cstring>
+#include <algorithm>
+#include <immintrin.h>
+#include "Viewport.hpp"
+
+
+// The absolute value of a complex number, being the distance from (0, 0) in the plain.
+// Calculating SQUARED distance value sqrt(a^2+b^2)^2 = a^2+b^2 instead of normal
+// distance value sqrt(a^2+b^2) for efficiency. A sum of squares is never negative, so
+// there is no need for abs().
+template <typename Number>
+Number absSquared(Complex<Number> *complex) {
+    return complex->real * complex->real + complex->imag * complex->imag;
+}
+
+
+// Square a complex number. 2 * real is written as real + real, which is exact and
+// doesn't need a scalar multiplication for the extended precision types.
+template <typename Number>
+Complex<Number> squareComplex(Complex<Number> *complex) {
+    Complex<Number> newComplex;
+    Number real = complex->real * complex->real - complex->imag * complex->imag;
+    Number imag = (complex->real + complex->real) * complex->imag;
+    initComplex(&newComplex, real, imag);
+    return newComplex;
+}
+
+
+// Add two complex numbers.
+template <typename Number>
+Complex<Number> addComplex(Complex<Number> *a, Complex<Number> *b) {
+    Complex<Number> c;
+    initComplex(&c, a->real + b->real, a->imag + b->imag);
+    return c;
+}
+
+
+// z^Power, multiplied out one factor at a time after squareComplex(), with the recursion
+// resolved at compile time. The SIMD kernels do the same operations in the same order.
+template <int Power, typename Number>
+static Complex<Number> powerComplex(Complex<Number> *z) {
+    if constexpr (Power == 2) {
+        return squareComplex(z);
+    } else {
+        Complex<Number> lower = powerComplex<Power - 1>(z);
+        Complex<Number> power;
+        initComplex(&power, lower.real * z->real - lower.imag * z->imag,
+                    lower.real * z->imag + lower.imag * z->real);
+        return power;
+    }
+}
+
+
+// Whether the orbit at z hasn't exploded yet. Orbits of Mandelbrot sets explode once
+// |z| >= 2, those of Julia sets only past the radius in the constants.
+template <Fractal F, typename Number>
+static bool bounded(Complex<Number> *z, const KernelConstants<Number> *constants) {
+    if constexpr (F == FractalMandelbrot) {
+        return absSquared(z) < 4;
+    } else {
+        return absSquared(z) < constants->escapeRadius2;
+    }
+}
+
+
+// Orbits are compared to the saved point every this many loops when looking for cycles.
+// Checking only every few loops keeps the cost low for pixels that explode, and since
+// the saved point is moved at powers of two (multiples of the interval too) every cycle
+// length still gets caught eventually.
+static const int cycleCheckInterval = 8;
+
+
+// Difference in both the real and the imaginary part below which two points of an orbit
+// count as the same, 16 units of the last place of the number type for |z| around 1.
+// Orbits of inside pixels converge to their cycle down to rounding noise, while outside
+// pixels close to the border can follow a cycle for hundreds of loops before exploding,
+// so anything looser turns some of them black. The parts are compared on their own
+// instead of squared, since squares of differences this small are denormals, which are
+// very slow, and lanes that are already done keep running along in the SIMD kernels.
+template <typename Number>
+static double cycleTolerance() {
+    return ldexp(1.0, -(NumberTraits<Number>::mantissaBits - 4));
+}
+
+
+// Whether c lies in the main cardioid or the period-2 bulb, where the sequence never
+// explodes. Cardioid: q * (q + (x - 1/4)) < y^2 / 4 with q = (x - 1/4)^2 + y^2,
+// bulb: (x + 1)^2 + y^2 < 1/16. Written as a difference below zero so the extended
+// precision types only need a comparison against a double.
+template <typename Number>
+static bool insideCardioidOrBulb(Complex<Number> *c) {
+    Number imag2 = c->imag * c->imag;
+    Number shifted = c->real - Number(0.25);
+    Number q = shifted * shifted + imag2;
+    if (q * (q + shifted) - Number(0.25) * imag2 < 0.0) {
+        return true;
+    }
+    Number bulb = c->real + Number(1);
+    return bulb * bulb + imag2 - Number(0.0625) < 0.0;
+}
+
+
+// Continue the sequence of the fractal on pixel from where it stopped until it explodes
+// or the amount of max loops is reached. With interiorChecks, pixels that are known to
+// be inside the set stop with max loops right away: either the pixel is in the main
+// cardioid or period-2 bulb of the Mandelbrot set, which is only checked before the
+// first loop, or the orbit repeats itself (Brent's cycle detection, the saved point is
+// moved ahead at every power of two so the distance to it keeps growing past any cycle
+// length). The checks only depend on the amount of loops done, so continuing gives the
+// same result as starting over.
+template <Fractal F, int Power, typename Number>
+static int continueFractal(Complex<Number> *pixel, int loops, int maxLoops,
+                           bool interiorChecks, const KernelConstants<Number> *constants,
+                           Orbit<Number> *orbit) {
+    if constexpr (F == FractalMandelbrot && Power == 2) {
+        if (interiorChecks && loops == 0 && insideCardioidOrBulb(pixel)) {
+            orbit->status = OrbitInside;
+            return maxLoops;
+        }
+    }
+    Complex<Number> c = F == FractalMandelbrot ? *pixel : constants->julia;
+    const double tolerance = cycleTolerance<Number>();
+    int amountLoops = loops;
+    Complex<Number> sumSequence = orbit->z;
+    Complex<Number> saved = orbit->saved;
+    // normally the value "explodes" when abs >= 2, but because we have squared abs,
+    // we abort if it gets >= 4 okayge.
+    while (amountLoops < maxLoops && bounded<F>(&sumSequence, constants)) {
+        Complex<Number> powered = powerComplex<Power>(&sumSequence);
+        sumSequence = addComplex(&powered, &c);
+        amountLoops++;
+        if (interiorChecks && amountLoops % cycleCheckInterval == 0) {
+            Number differenceReal = sumSequence.real - saved.real;
+            Number differenceImag = sumSequence.imag - saved.imag;
+            if (differenceReal < tolerance && -differenceReal < tolerance
+                && differenceImag < tolerance && -differenceImag < tolerance) {
+                orbit->status = OrbitInside;
+                return maxLoops;
+            }
+            if ((amountLoops & (amountLoops - 1)) == 0) {
+                saved = sumSequence;
+            }
+        }
+    }
+    orbit->z = sumSequence;
+    orbit->saved = saved;
+    orbit->status = bounded<F>(&sumSequence, constants) ? OrbitRunning : OrbitEscaped;
+    return amountLoops;
+}
+
+
+// Where the orbit of a pixel starts, z = 0 for Mandelbrot sets and the pixel itself for
+// Julia sets, which is also the first point saved for cycle detection.
+template <Fractal F, typename Number>
+static void startOrbit(Complex<Number> *pixel, Orbit<Number> *orbit) {
+    if constexpr (F == FractalMandelbrot) {
+        initComplex(&orbit->z, Number(0), Number(0));
+    } else {
+        orbit->z = *pixel;
+    }
+    orbit->saved = orbit->z;
+}
+
+
+template <typename Number>
+int continueMandelbrot(Complex<Number> *c, int loops, int maxLoops, bool interiorChecks,
+                       Orbit<Number> *orbit) {
+    // the Mandelbrot set needs no constants
+    const KernelConstants<Number>* constants = nullptr;
+    return continueFractal<FractalMandelbrot, 2>(c, loops, maxLoops, interiorChecks,
+                                                 constants, orbit);
+}
+
+
+template int continueMandelbrot<float>(Complex<float> *c, int loops, int maxLoops,
+                                       bool interiorChecks, Orbit<float> *orbit);
+template int continueMandelbrot<double>(Complex<double> *c, int loops, int maxLoops,
+                                        bool interiorChecks, Orbit<double> *orbit);
+template int continueMandelbrot<DoubleDouble>(Complex<DoubleDouble> *c, int loops,
+                                              int maxLoops, bool interiorChecks,
+                                              Orbit<DoubleDouble> *orbit);
+template int continueMandelbrot<QuadDouble>(Complex<QuadDouble> *c, int loops, int maxLoops,
+                                            bool interiorChecks, Orbit<QuadDouble> *orbit);
+
+
+// Run the "mandelbrot sequence" on given complex number from the start.
+template <typename Number>
+int mandelbrot(Complex<Number> *c, int maxLoops, bool interiorChecks) {
+    Orbit<Number> orbit;
+    startOrbit<FractalMandelbrot>(c, &orbit);
+    return continueMandelbrot(c, 0, maxLoops, interiorChecks, &orbit);
+}
+
+
+template int mandelbrot<float>(Complex<float> *c, int maxLoops,
+                               bool interiorChecks);
+template int mandelbrot<double>(Complex<double> *c, int maxLoops,
+                                bool interiorChecks);
+template int mandelbrot<DoubleDouble>(Complex<DoubleDouble> *c, int maxLoops,
+                                      bool interiorChecks);
+template int mandelbrot<QuadDouble>(Complex<QuadDouble> *c, int maxLoops,
+                                    bool interiorChecks);
+
+
+// Scalar fallback, simply runs the sequence on every pixel of the row one by one.
+template <Fractal F, int Power, typename Number>
+static void fractalRowScalar(const Number* cReal, const Number* cImag, int count,
+                             int maxLoops, bool interiorChecks,
+                             const KernelConstants<Number>* constants, int* loops,
+                             Orbit<Number>* orbits) {
+    for (int x = 0; x < count; ++x) {
+        Complex<Number> pixel;
+        initComplex(&pixel, cReal[x], cImag[x]);
+        Orbit<Number> orbit;
+        Orbit<Number>* stopped = orbits == nullptr ? &orbit : &orbits[x];
+        startOrbit<F>(&pixel, stopped);
+        loops[x] = continueFractal<F, Power>(&pixel, 0, maxLoops, interiorChecks, constants,
+                                             stopped);
+    }
+}
+
+
+// Write the orbits of one vector of Lanes pixels, stored lane by lane in the arrays.
+// running and inside have bit i set if lane i is still running or was found inside the
+// set, every other lane exploded.
+template <int Lanes, typename Number>
+static void storeOrbits(const Number* zr, const Number* zi, const Number* savedR,
+                        const Number* savedI, int running, int inside,
+                        Orbit<Number>* orbits) {
+    for (int lane = 0; lane < Lanes; ++lane) {
+        initComplex(&orbits[lane].z, zr[lane], zi[lane]);
+        initComplex(&orbits[lane].saved, savedR[lane], savedI[lane]);
+        orbits[lane].status = (inside >> lane) & 1 ? OrbitInside
+                              : (running >> lane) & 1 ? OrbitRunning : OrbitEscaped;
+    }
+}
+
+
+// Run the pixels from x to count of a row through one more call of a SIMD row kernel
+// with Lanes pixels, filling the lanes past the end with copies of the last pixel.
+template <int Lanes, typename Number>
+static void runPaddedTail(RowKernelFunction<Number> kernel, const Number* cReal,
+                          const Number* cImag, int x, int count, int maxLoops,
+                          bool interiorChecks, const KernelConstants<Number>* constants,
+                          int* loops, Orbit<Number>* orbits) {
+    Number real[Lanes];
+    Number imag[Lanes];
+    int tail[Lanes];
+    Orbit<Number> tailOrbits[Lanes];
+    for (int lane = 0; lane < Lanes; ++lane) {
+        int from = std::min(x + lane, count - 1);
+        real[lane] = cReal[from];
+        imag[lane] = cImag[from];
+    }
+    kernel(real, imag, Lanes, maxLoops, interiorChecks, constants, tail,
+           orbits == nullptr ? nullptr : tailOrbits);
+    std::copy(tail, tail + (count - x), loops + x);
+    if (orbits != nullptr) {
+        std::copy(tailOrbits, tailOrbits + (count - x), orbits + x);
+    }
+}
+
+
+// AVX2 kernel running 4 doubles at once. Every lane does exactly the same floating point
+// operations in the same order as mandelbrot(), so the result is bit-identical. Lanes
+// that exploded are masked out and stop counting, the vector keeps going until all four
+// lanes exploded or max loops is reached. Lanes found inside the set by the interior
+// checks get max loops and are masked out the same way.
+template <Fractal F, int Power>
+__attribute__((target("avx2")))
+static void fractalRowAvx2(const double* cReal, const double* cImag, int count,
+                           int maxLoops, bool interiorChecks,
+                           const KernelConstants<double>* constants, int* loops,
+                           Orbit<double>* orbits) {
+    // Mandelbrot sets explode past 2, Julia sets past the radius of their c
+    const __m256d escape = _mm256_set1_pd(F == FractalMandelbrot ? 4.0
+                                          : constants->escapeRadius2);
+    const __m256d juliaR = _mm256_set1_pd(constants->julia.real);
+    const __m256d juliaI = _mm256_set1_pd(constants->julia.imag);
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const __m256d bulbRadius2 = _mm256_set1_pd(0.0625);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d tolerance = _mm256_set1_pd(cycleTolerance<double>());
+    const __m256d minusTolerance = _mm256_sub_pd(zero, tolerance);
+    const __m256i maxVector = _mm256_set1_epi64x(maxLoops);
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        // the pixels are c for Mandelbrot sets and where z starts for Julia sets
+        const __m256d pixelR = _mm256_loadu_pd(cReal + x);
+        const __m256d pixelI = _mm256_loadu_pd(cImag + x);
+        const __m256d cr = F == FractalMandelbrot ? pixelR : juliaR;
+        const __m256d ci = F == FractalMandelbrot ? pixelI : juliaI;
+        __m256d zr = F == FractalMandelbrot ? _mm256_setzero_pd() : pixelR;
+        __m256d zi = F == FractalMandelbrot ? _mm256_setzero_pd() : pixelI;
+        __m256d savedR = zr;
+        __m256d savedI = zi;
+        // all bits set while a lane is still running
+        __m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        __m256i amountLoops = _mm256_setzero_si256();
+        // lanes found inside the set, as opposed to exploded ones
+        __m256d interior = _mm256_setzero_pd();
+        if (F == FractalMandelbrot && Power == 2 && interiorChecks) {
+            const __m256d ci2 = _mm256_mul_pd(ci, ci);
+            __m256d shifted = _mm256_sub_pd(cr, quarter);
+            __m256d q = _mm256_add_pd(_mm256_mul_pd(shifted, shifted), ci2);
+            __m256d cardioid = _mm256_sub_pd(_mm256_mul_pd(q, _mm256_add_pd(q, shifted)),
+                                             _mm256_mul_pd(quarter, ci2));
+            __m256d bulb = _mm256_add_pd(cr, one);
+            bulb = _mm256_sub_pd(_mm256_add_pd(_mm256_mul_pd(bulb, bulb), ci2), bulbRadius2);
+            __m256d inside = _mm256_or_pd(_mm256_cmp_pd(cardioid, zero, _CMP_LT_OQ),
+                                          _mm256_cmp_pd(bulb, zero, _CMP_LT_OQ));
+            amountLoops = _mm256_castpd_si256(_mm256_blendv_pd(
+                _mm256_castsi256_pd(amountLoops), _mm256_castsi256_pd(maxVector), inside));
+            active = _mm256_andnot_pd(inside, active);
+            interior = inside;
+        }
+        for (int i = 0; i < maxLoops; ++i) {
+            __m256d zr2 = _mm256_mul_pd(zr, zr);
+            __m256d zi2 = _mm256_mul_pd(zi, zi);
+            active = _mm256_and_pd(active,
+                        _mm256_cmp_pd(_mm256_add_pd(zr2, zi2), escape, _CMP_LT_OQ));
+            if (_mm256_movemask_pd(active) == 0) {
+                break;
+            }
+            // active lanes are -1, so subtracting the mask counts them up
+            amountLoops = _mm256_sub_epi64(amountLoops, _mm256_castpd_si256(active));
+            __m256d powerR = _mm256_sub_pd(zr2, zi2);
+            __m256d powerI = _mm256_mul_pd(_mm256_add_pd(zr, zr), zi);
+            // the rest of z^Power, in the same order as powerComplex()
+#pragma GCC unroll 8
+            for (int k = 2; k < Power; ++k) {
+                __m256d nextR = _mm256_sub_pd(_mm256_mul_pd(powerR, zr),
+                                              _mm256_mul_pd(powerI, zi));
+                powerI = _mm256_add_pd(_mm256_mul_pd(powerR, zi), _mm256_mul_pd(powerI, zr));
+                powerR = nextR;
+            }
+            zi = _mm256_add_pd(powerI, ci);
+            zr = _mm256_add_pd(powerR, cr);
+            // every active lane has done i + 1 loops now, same checks as mandelbrot()
+            const int done = i + 1;
+            if (interiorChecks && done % cycleCheckInterval == 0) {
+                __m256d dr = _mm256_sub_pd(zr, savedR);
+                __m256d di = _mm256_sub_pd(zi, savedI);
+                __m256d close = _mm256_and_pd(
+                    _mm256_and_pd(_mm256_cmp_pd(dr, tolerance, _CMP_LT_OQ),
+                                  _mm256_cmp_pd(dr, minusTolerance, _CMP_GT_OQ)),
+                    _mm256_and_pd(_mm256_cmp_pd(di, tolerance, _CMP_LT_OQ),
+                                  _mm256_cmp_pd(di, minusTolerance, _CMP_GT_OQ)));
+                __m256d cycle = _mm256_and_pd(active, close);
+                amountLoops = _mm256_castpd_si256(_mm256_blendv_pd(
+                    _mm256_castsi256_pd(amountLoops), _mm256_castsi256_pd(maxVector), cycle));
+                active = _mm256_andnot_pd(cycle, active);
+                interior = _mm256_or_pd(interior, cycle);
+                if ((done & (done - 1)) == 0) {
+                    savedR = zr;
+                    savedI = zi;
+                }
+            }
+        }
+        alignas(32) long long lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), amountLoops);
+        for (int lane = 0; lane < 4; ++lane) {
+            loops[x + lane] = static_cast<int>(lanes[lane]);
+        }
+        if (orbits != nullptr) {
+            alignas(32) double lanesR[4], lanesI[4], lanesSavedR[4], lanesSavedI[4];
+            _mm256_store_pd(lanesR, zr);
+            _mm256_store_pd(lanesI, zi);
+            _mm256_store_pd(lanesSavedR, savedR);
+            _mm256_store_pd(lanesSavedI, savedI);
+            storeOrbits<4>(lanesR, lanesI, lanesSavedR, lanesSavedI,
+                           _mm256_movemask_pd(active), _mm256_movemask_pd(interior),
+                           orbits + x);
+        }
+    }
+    // leftover pixels that don't fill a whole vector go through one more vector, padded
+    // with copies of the last pixel. Every lane computes on its own, so this gives the
+    // same result as the scalar loop, but short rows still run at vector speed.
+    if (x < count) {
+        runPaddedTail<4>(fractalRowAvx2<F, Power>, cReal, cImag, x, count, maxLoops,
+                         interiorChecks, constants, loops, orbits);
+    }
+}
+
+
+// AVX-512 kernel running 8 doubles at once, same idea as the AVX2 one but with mask
+// registers instead of all-bits-set vectors.
+template <Fractal F, int Power>
+__attribute__((target("avx512f")))
+static void fractalRowAvx512(const double* cReal, const double* cImag, int count,
+                             int maxLoops, bool interiorChecks,
+                             const KernelConstants<double>* constants, int* loops,
+                             Orbit<double>* orbits) {
+    // Mandelbrot sets explode past 2, Julia sets past the radius of their c
+    const __m512d escape = _mm512_set1_pd(F == FractalMandelbrot ? 4.0
+                                          : constants->escapeRadius2);
+    const __m512d juliaR = _mm512_set1_pd(constants->julia.real);
+    const __m512d juliaI = _mm512_set1_pd(constants->julia.imag);
+    const __m512d quarter = _mm512_set1_pd(0.25);
+    const __m512d bulbRadius2 = _mm512_set1_pd(0.0625);
+    const __m512d oneReal = _mm512_set1_pd(1.0);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d tolerance = _mm512_set1_pd(cycleTolerance<double>());
+    const __m512d minusTolerance = _mm512_sub_pd(zero, tolerance);
+    const __m512i maxVector = _mm512_set1_epi64(maxLoops);
+    const __m512i one = _mm512_set1_epi64(1);
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        // the pixels are c for Mandelbrot sets and where z starts for Julia sets
+        const __m512d pixelR = _mm512_loadu_pd(cReal + x);
+        const __m512d pixelI = _mm512_loadu_pd(cImag + x);
+        const __m512d cr = F == FractalMandelbrot ? pixelR : juliaR;
+        const __m512d ci = F == FractalMandelbrot ? pixelI : juliaI;
+        __m512d zr = F == FractalMandelbrot ? _mm512_setzero_pd() : pixelR;
+        __m512d zi = F == FractalMandelbrot ? _mm512_setzero_pd() : pixelI;
+        __m512d savedR = zr;
+        __m512d savedI = zi;
+        __mmask8 active = 0xFF;
+        __m512i amountLoops = _mm512_setzero_si512();
+        // lanes found inside the set, as opposed to exploded ones
+        __mmask8 interior = 0;
+        if (F == FractalMandelbrot && Power == 2 && interiorChecks) {
+            const __m512d ci2 = _mm512_mul_pd(ci, ci);
+            __m512d shifted = _mm512_sub_pd(cr, quarter);
+            __m512d q = _mm512_add_pd(_mm512_mul_pd(shifted, shifted), ci2);
+            __m512d cardioid = _mm512_sub_pd(_mm512_mul_pd(q, _mm512_add_pd(q, shifted)),
+                                             _mm512_mul_pd(quarter, ci2));
+            __m512d bulb = _mm512_add_pd(cr, oneReal);
+            bulb = _mm512_sub_pd(_mm512_add_pd(_mm512_mul_pd(bulb, bulb), ci2), bulbRadius2);
+            __mmask8 inside = _mm512_cmp_pd_mask(cardioid, zero, _CMP_LT_OQ)
+                              | _mm512_cmp_pd_mask(bulb, zero, _CMP_LT_OQ);
+            amountLoops = _mm512_mask_mov_epi64(amountLoops, inside, maxVector);
+            active &= ~inside;
+            interior = inside;
+        }
+        for (int i = 0; i < maxLoops; ++i) {
+            __m512d zr2 = _mm512_mul_pd(zr, zr);
+            __m512d zi2 = _mm512_mul_pd(zi, zi);
+            active = _mm512_mask_cmp_pd_mask(active, _mm512_add_pd(zr2, zi2), escape,
+                                             _CMP_LT_OQ);
+            if (active == 0) {
+                break;
+            }
+            amountLoops = _mm512_mask_add_epi64(amountLoops, active, amountLoops, one);
+            __m512d powerR = _mm512_sub_pd(zr2, zi2);
+            __m512d powerI = _mm512_mul_pd(_mm512_add_pd(zr, zr), zi);
+            // the rest of z^Power, in the same order as powerComplex()
+#pragma GCC unroll 8
+            for (int k = 2; k < Power; ++k) {
+                __m512d nextR = _mm512_sub_pd(_mm512_mul_pd(powerR, zr),
+                                              _mm512_mul_pd(powerI, zi));
+                powerI = _mm512_add_pd(_mm512_mul_pd(powerR, zi), _mm512_mul_pd(powerI, zr));
+                powerR = nextR;
+            }
+            zi = _mm512_add_pd(powerI, ci);
+            zr = _mm512_add_pd(powerR, cr);
+            const int done = i + 1;
+            if (interiorChecks && done % cycleCheckInterval == 0) {
+                __m512d dr = _mm512_sub_pd(zr, savedR);
+                __m512d di = _mm512_sub_pd(zi, savedI);
+                __mmask8 cycle = _mm512_mask_cmp_pd_mask(active, dr, tolerance, _CMP_LT_OQ);
+                cycle = _mm512_mask_cmp_pd_mask(cycle, dr, minusTolerance, _CMP_GT_OQ);
+                cycle = _mm512_mask_cmp_pd_mask(cycle, di, tolerance, _CMP_LT_OQ);
+                cycle = _mm512_mask_cmp_pd_mask(cycle, di, minusTolerance, _CMP_GT_OQ);
+                amountLoops = _mm512_mask_mov_epi64(amountLoops, cycle, maxVector);
+                active &= ~cycle;
+                interior |= cycle;
+                if ((done & (done - 1)) == 0) {
+                    savedR = zr;
+                    savedI = zi;
+                }
+            }
+        }
+        alignas(64) long long lanes[8];
+        _mm512_store_si512(lanes, amountLoops);
+        for (int lane = 0; lane < 8; ++lane) {
+            loops[x + lane] = static_cast<int>(lanes[lane]);
+        }
+        if (orbits != nullptr) {
+            alignas(64) double lanesR[8], lanesI[8], lanesSavedR[8], lanesSavedI[8];
+            _mm512_store_pd(lanesR, zr);
+            _mm512_store_pd(lanesI, zi);
+            _mm512_store_pd(lanesSavedR, savedR);
+            _mm512_store_pd(lanesSavedI, savedI);
+            storeOrbits<8>(lanesR, lanesI, lanesSavedR, lanesSavedI,
+                           active, interior, orbits + x);
+        }
+    }
+    // leftover pixels that don't fill a whole vector
+    if (x < count) {
+        runPaddedTail<8>(fractalRowAvx512<F, Power>, cReal, cImag, x, count, maxLoops,
+                         interiorChecks, constants, loops, orbits);
+    }
+}
+
+
+// AVX2 kernel for floats, same as the double one but with 8 pixels at once.
+template <Fractal F, int Power>
+__attribute__((target("avx2")))
+static void fractalRowAvx2Float(const float* cReal, const float* cImag, int count,
+                                int maxLoops, bool interiorChecks,
+                                const KernelConstants<float>* constants, int* loops,
+                                Orbit<float>* orbits) {
+    // Mandelbrot sets explode past 2, Julia sets past the radius of their c
+    const __m256 escape = _mm256_set1_ps(F == FractalMandelbrot ? 4.0f
+                                         : static_cast<float>(constants->escapeRadius2));
+    const __m256 juliaR = _mm256_set1_ps(constants->julia.real);
+    const __m256 juliaI = _mm256_set1_ps(constants->julia.imag);
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 bulbRadius2 = _mm256_set1_ps(0.0625f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 tolerance = _mm256_set1_ps(static_cast<float>(cycleTolerance<float>()));
+    const __m256 minusTolerance = _mm256_sub_ps(zero, tolerance);
+    const __m256i maxVector = _mm256_set1_epi32(maxLoops);
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        // the pixels are c for Mandelbrot sets and where z starts for Julia sets
+        const __m256 pixelR = _mm256_loadu_ps(cReal + x);
+        const __m256 pixelI = _mm256_loadu_ps(cImag + x);
+        const __m256 cr = F == FractalMandelbrot ? pixelR : juliaR;
+        const __m256 ci = F == FractalMandelbrot ? pixelI : juliaI;
+        __m256 zr = F == FractalMandelbrot ? _mm256_setzero_ps() : pixelR;
+        __m256 zi = F == FractalMandelbrot ? _mm256_setzero_ps() : pixelI;
+        __m256 savedR = zr;
+        __m256 savedI = zi;
+        __m256 active = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        __m256i amountLoops = _mm256_setzero_si256();
+        // lanes found inside the set, as opposed to exploded ones
+        __m256 interior = _mm256_setzero_ps();
+        if (F == FractalMandelbrot && Power == 2 && interiorChecks) {
+            const __m256 ci2 = _mm256_mul_ps(ci, ci);
+            __m256 shifted = _mm256_sub_ps(cr, quarter);
+            __m256 q = _mm256_add_ps(_mm256_mul_ps(shifted, shifted), ci2);
+            __m256 cardioid = _mm256_sub_ps(_mm256_mul_ps(q, _mm256_add_ps(q, shifted)),
+                                            _mm256_mul_ps(quarter, ci2));
+            __m256 bulb = _mm256_add_ps(cr, one);
+            bulb = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(bulb, bulb), ci2), bulbRadius2);
+            __m256 inside = _mm256_or_ps(_mm256_cmp_ps(cardioid, zero, _CMP_LT_OQ),
+                                         _mm256_cmp_ps(bulb, zero, _CMP_LT_OQ));
+            amountLoops = _mm256_castps_si256(_mm256_blendv_ps(
+                _mm256_castsi256_ps(amountLoops), _mm256_castsi256_ps(maxVector), inside));
+            active = _mm256_andnot_ps(inside, active);
+            interior = inside;
+        }
+        for (int i = 0; i < maxLoops; ++i) {
+            __m256 zr2 = _mm256_mul_ps(zr, zr);
+            __m256 zi2 = _mm256_mul_ps(zi, zi);
+            active = _mm256_and_ps(active,
+                        _mm256_cmp_ps(_mm256_add_ps(zr2, zi2), escape, _CMP_LT_OQ));
+            if (_mm256_movemask_ps(active) == 0) {
+                break;
+            }
+            amountLoops = _mm256_sub_epi32(amountLoops, _mm256_castps_si256(active));
+            __m256 powerR = _mm256_sub_ps(zr2, zi2);
+            __m256 powerI = _mm256_mul_ps(_mm256_add_ps(zr, zr), zi);
+            // the rest of z^Power, in the same order as powerComplex()
+#pragma GCC unroll 8
+            for (int k = 2; k < Power; ++k) {
+                __m256 nextR = _mm256_sub_ps(_mm256_mul_ps(powerR, zr),
+                                             _mm256_mul_ps(powerI, zi));
+                powerI = _mm256_add_ps(_mm256_mul_ps(powerR, zi), _mm256_mul_ps(powerI, zr));
+                powerR = nextR;
+            }
+            zi = _mm256_add_ps(powerI, ci);
+            zr = _mm256_add_ps(powerR, cr);
+            const int done = i + 1;
+            if (interiorChecks && done % cycleCheckInterval == 0) {
+                __m256 dr = _mm256_sub_ps(zr, savedR);
+                __m256 di = _mm256_sub_ps(zi, savedI);
+                __m256 close = _mm256_and_ps(
+                    _mm256_and_ps(_mm256_cmp_ps(dr, tolerance, _CMP_LT_OQ),
+                                  _mm256_cmp_ps(dr, minusTolerance, _CMP_GT_OQ)),
+                    _mm256_and_ps(_mm256_cmp_ps(di, tolerance, _CMP_LT_OQ),
+                                  _mm256_cmp_ps(di, minusTolerance, _CMP_GT_OQ)));
+                __m256 cycle = _mm256_and_ps(active, close);
+                amountLoops = _mm256_castps_si256(_mm256_blendv_ps(
+                    _mm256_castsi256_ps(amountLoops), _mm256_castsi256_ps(maxVector), cycle));
+                active = _mm256_andnot_ps(cycle, active);
+                interior = _mm256_or_ps(interior, cycle);
+                if ((done & (done - 1)) == 0) {
+                    savedR = zr;
+                    savedI = zi;
+                }
+            }
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(loops + x), amountLoops);
+        if (orbits != nullptr) {
+            alignas(32) float lanesR[8], lanesI[8], lanesSavedR[8], lanesSavedI[8];
+            _mm256_store_ps(lanesR, zr);
+            _mm256_store_ps(lanesI, zi);
+            _mm256_store_ps(lanesSavedR, savedR);
+            _mm256_store_ps(lanesSavedI, savedI);
+            storeOrbits<8>(lanesR, lanesI, lanesSavedR, lanesSavedI,
+                           _mm256_movemask_ps(active), _mm256_movemask_ps(interior),
+                           orbits + x);
+        }
+    }
+    // leftover pixels that don't fill a whole vector
+    if (x < count) {
+        runPaddedTail<8>(fractalRowAvx2Float<F, Power>, cReal, cImag, x, count, maxLoops,
+                         interiorChecks, constants, loops, orbits);
+    }
+}
+
+
+// AVX-512 kernel for floats, 16 pixels at once.
+template <Fractal F, int Power>
+__attribute__((target("avx512f")))
+static void fractalRowAvx512Float(const float* cReal, const float* cImag, int count,
+                                  int maxLoops, bool interiorChecks,
+                                  const KernelConstants<float>* constants, int* loops,
+                                  Orbit<float>* orbits) {
+    // Mandelbrot sets explode past 2, Julia sets past the radius of their c
+    const __m512 escape = _mm512_set1_ps(F == FractalMandelbrot ? 4.0f
+                                         : static_cast<float>(constants->escapeRadius2));
+    const __m512 juliaR = _mm512_set1_ps(constants->julia.real);
+    const __m512 juliaI = _mm512_set1_ps(constants->julia.imag);
+    const __m512 quarter = _mm512_set1_ps(0.25f);
+    const __m512 bulbRadius2 = _mm512_set1_ps(0.0625f);
+    const __m512 oneReal = _mm512_set1_ps(1.0f);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 tolerance = _mm512_set1_ps(static_cast<float>(cycleTolerance<float>()));
+    const __m512 minusTolerance = _mm512_sub_ps(zero, tolerance);
+    const __m512i maxVector = _mm512_set1_epi32(maxLoops);
+    const __m512i one = _mm512_set1_epi32(1);
+    int x = 0;
+    for (; x + 16 <= count; x += 16) {
+        // the pixels are c for Mandelbrot sets and where z starts for Julia sets
+        const __m512 pixelR = _mm512_loadu_ps(cReal + x);
+        const __m512 pixelI = _mm512_loadu_ps(cImag + x);
+        const __m512 cr = F == FractalMandelbrot ? pixelR : juliaR;
+        const __m512 ci = F == FractalMandelbrot ? pixelI : juliaI;
+        __m512 zr = F == FractalMandelbrot ? _mm512_setzero_ps() : pixelR;
+        __m512 zi = F == FractalMandelbrot ? _mm512_setzero_ps() : pixelI;
+        __m512 savedR = zr;
+        __m512 savedI = zi;
+        __mmask16 active = 0xFFFF;
+        __m512i amountLoops = _mm512_setzero_si512();
+        // lanes found inside the set, as opposed to exploded ones
+        __mmask16 interior = 0;
+        if (F == FractalMandelbrot && Power == 2 && interiorChecks) {
+            const __m512 ci2 = _mm512_mul_ps(ci, ci);
+            __m512 shifted = _mm512_sub_ps(cr, quarter);
+            __m512 q = _mm512_add_ps(_mm512_mul_ps(shifted, shifted), ci2);
+            __m512 cardioid = _mm512_sub_ps(_mm512_mul_ps(q, _mm512_add_ps(q, shifted)),
+                                            _mm512_mul_ps(quarter, ci2));
+            __m512 bulb = _mm512_add_ps(cr, oneReal);
+            bulb = _mm512_sub_ps(_mm512_add_ps(_mm512_mul_ps(bulb, bulb), ci2), bulbRadius2);
+            __mmask16 inside = _mm512_cmp_ps_mask(cardioid, zero, _CMP_LT_OQ)
+                               | _mm512_cmp_ps_mask(bulb, zero, _CMP_LT_OQ);
+            amountLoops = _mm512_mask_mov_epi32(amountLoops, inside, maxVector);
+            active &= ~inside;
+            interior = inside;
+        }
+        for (int i = 0; i < maxLoops; ++i) {
+            __m512 zr2 = _mm512_mul_ps(zr, zr);
+            __m512 zi2 = _mm512_mul_ps(zi, zi);
+            active = _mm512_mask_cmp_ps_mask(active, _mm512_add_ps(zr2, zi2), escape,
+                                             _CMP_LT_OQ);
+            if (active == 0) {
+                break;
+            }
+            amountLoops = _mm512_mask_add_epi32(amountLoops, active, amountLoops, one);
+            __m512 powerR = _mm512_sub_ps(zr2, zi2);
+            __m512 powerI = _mm512_mul_ps(_mm512_add_ps(zr, zr), zi);
+            // the rest of z^Power, in the same order as powerComplex()
+#pragma GCC unroll 8
+            for (int k = 2; k < Power; ++k) {
+                __m512 nextR = _mm512_sub_ps(_mm512_mul_ps(powerR, zr),
+                                             _mm512_mul_ps(powerI, zi));
+                powerI = _mm512_add_ps(_mm512_mul_ps(powerR, zi), _mm512_mul_ps(powerI, zr));
+                powerR = nextR;
+            }
+            zi = _mm512_add_ps(powerI, ci);
+            zr = _mm512_add_ps(powerR, cr);
+            const int done = i + 1;
+            if (interiorChecks && done % cycleCheckInterval == 0) {
+                __m512 dr = _mm512_sub_ps(zr, savedR);
+                __m512 di = _mm512_sub_ps(zi, savedI);
+                __mmask16 cycle = _mm512_mask_cmp_ps_mask(active, dr, tolerance, _CMP_LT_OQ);
+                cycle = _mm512_mask_cmp_ps_mask(cycle, dr, minusTolerance, _CMP_GT_OQ);
+                cycle = _mm512_mask_cmp_ps_mask(cycle, di, tolerance, _CMP_LT_OQ);
+                cycle = _mm512_mask_cmp_ps_mask(cycle, di, minusTolerance, _CMP_GT_OQ);
+                amountLoops = _mm512_mask_mov_epi32(amountLoops, cycle, maxVector);
+                active &= ~cycle;
+                interior |= cycle;
+                if ((done & (done - 1)) == 0) {
+                    savedR = zr;
+                    savedI = zi;
+                }
+            }
+        }
+        _mm512_storeu_si512(loops + x, amountLoops);
+        if (orbits != nullptr) {
+            alignas(64) float lanesR[16], lanesI[16], lanesSavedR[16], lanesSavedI[16];
+            _mm512_store_ps(lanesR, zr);
+            _mm512_store_ps(lanesI, zi);
+            _mm512_store_ps(lanesSavedR, savedR);
+            _mm512_store_ps(lanesSavedI, savedI);
+            storeOrbits<16>(lanesR, lanesI, lanesSavedR, lanesSavedI,
+                            active, interior, orbits + x);
+        }
+    }
+    // leftover pixels that don't fill a whole vector
+    if (x < count) {
+        runPaddedTail<16>(fractalRowAvx512Float<F, Power>, cReal, cImag, x, count, maxLoops,
+                          interiorChecks, constants, loops, orbits);
+    }
+}
+
+
+// Instruction sets with row kernels, widest last.
+enum InstructionSet {
+    InstructionSetScalar,
+    InstructionSetAvx2,
+    InstructionSetAvx512
+};
+
+
+static const char* instructionSetNames[] = {"scalar", "avx2", "avx512"};
+
+
+// A row kernel with the matching function to continue its orbits.
+template <typename Number>
+static RowKernel<Number> rowKernel(RowKernelFunction<Number> run,
+                                   ResumeFunction<Number> resume) {
+    RowKernel<Number> kernel;
+    kernel.run = run;
+    kernel.resumeOrbit = resume;
+    return kernel;
+}
+
+
+// The row kernels of one instruction set for the fractal with z raised to Power.
+template <Fractal F, int Power>
+static RowKernels kernelsOf(InstructionSet set) {
+    RowKernels kernels;
+    kernels.name = instructionSetNames[set];
+    kernels.fractal = F;
+    kernels.power = Power;
+    kernels.conjugateSymmetric = true;
+    kernels.floatKernel = rowKernel<float>(fractalRowScalar<F, Power, float>,
+                                           continueFractal<F, Power, float>);
+    kernels.doubleKernel = rowKernel<double>(fractalRowScalar<F, Power, double>,
+                                             continueFractal<F, Power, double>);
+    kernels.doubleDoubleKernel = rowKernel<DoubleDouble>(
+        fractalRowScalar<F, Power, DoubleDouble>, continueFractal<F, Power, DoubleDouble>);
+    kernels.quadDoubleKernel = rowKernel<QuadDouble>(
+        fractalRowScalar<F, Power, QuadDouble>, continueFractal<F, Power, QuadDouble>);
+    if (set == InstructionSetAvx2) {
+        kernels.floatKernel.run = fractalRowAvx2Float<F, Power>;
+        kernels.doubleKernel.run = fractalRowAvx2<F, Power>;
+    } else if (set == InstructionSetAvx512) {
+        kernels.floatKernel.run = fractalRowAvx512Float<F, Power>;
+        kernels.doubleKernel.run = fractalRowAvx512<F, Power>;
+    }
+    return kernels;
+}
+
+
+// Every fractal and power, indexed by fractal and power - minPower.
+using KernelsOf = RowKernels (*)(InstructionSet set);
+static const KernelsOf kernelTable[][maxPower - minPower + 1] = {
+    {kernelsOf<FractalMandelbrot, 2>, kernelsOf<FractalMandelbrot, 3>,
+     kernelsOf<FractalMandelbrot, 4>, kernelsOf<FractalMandelbrot, 5>,
+     kernelsOf<FractalMandelbrot, 6>, kernelsOf<FractalMandelbrot, 7>,
+     kernelsOf<FractalMandelbrot, 8>},
+    {kernelsOf<FractalJulia, 2>, kernelsOf<FractalJulia, 3>, kernelsOf<FractalJulia, 4>,
+     kernelsOf<FractalJulia, 5>, kernelsOf<FractalJulia, 6>, kernelsOf<FractalJulia, 7>,
+     kernelsOf<FractalJulia, 8>}
+};
+
+
+// Pick the widest row kernels the CPU we are running on supports.
+RowKernels detectRowKernels() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return kernelsOf<FractalMandelbrot, 2>(InstructionSetAvx512);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return kernelsOf<FractalMandelbrot, 2>(InstructionSetAvx2);
+    }
+    return kernelsOf<FractalMandelbrot, 2>(InstructionSetScalar);
+}
+
+
+// Look up row kernels by name, used to force a specific instruction set for comparison.
+bool findRowKernels(const char* name, RowKernels* kernels) {
+    __builtin_cpu_init();
+    if (std::strcmp(name, "scalar") == 0) {
+        (*kernels) = kernelsOf<FractalMandelbrot, 2>(InstructionSetScalar);
+        return true;
+    }
+    if (std::strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        (*kernels) = kernelsOf<FractalMandelbrot, 2>(InstructionSetAvx2);
+        return true;
+    }
+    if (std::strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512f")) {
+        (*kernels) = kernelsOf<FractalMandelbrot, 2>(InstructionSetAvx512);
+        return true;
+    }
+    return false;
+}
+
+
+// Round c to the number type of the kernel and set the escape radius for it.
+template <typename Number>
+static void setJulia(const BigComplex* julia, double escapeRadius2,
+                     RowKernel<Number>* kernel) {
+    initComplex(&kernel->constants.julia, bigToNumber<Number>(julia->real),
+                bigToNumber<Number>(julia->imag));
+    kernel->constants.escapeRadius2 = escapeRadius2;
+}
+
+
+// Orbits of a Julia set explode once |z| > max(2, |c|): past that |z^n + c| > |z| for
+// every n >= 2. The squared radius is rounded up to a whole number, so that the float
+// kernels compare against exactly the same bound as the double ones.
+void selectFractal(RowKernels* kernels, Fractal fractal, int power, const BigComplex* julia) {
+    InstructionSet set = InstructionSetScalar;
+    for (int i = InstructionSetScalar; i <= InstructionSetAvx512; ++i) {
+        if (std::strcmp(kernels->name, instructionSetNames[i]) == 0) {
+            set = static_cast<InstructionSet>(i);
+        }
+    }
+    (*kernels) = kernelTable[fractal][power - minPower](set);
+    if (fractal != FractalJulia) {
+        return;
+    }
+    const double real = julia->real.get_d();
+    const double imag = julia->imag.get_d();
+    const double escapeRadius2 = std::max(4.0, ceil(real * real + imag * imag));
+    setJulia(julia, escapeRadius2, &kernels->floatKernel);
+    setJulia(julia, escapeRadius2, &kernels->doubleKernel);
+    setJulia(julia, escapeRadius2, &kernels->doubleDoubleKernel);
+    setJulia(julia, escapeRadius2, &kernels->quadDoubleKernel);
+    // the conjugate of z^n + c is conj(z)^n + conj(c), which is the same sequence only
+    // for a real c
+    kernels->conjugateSymmetric = julia->imag == 0;
+}
+
+
+bool hasPerturbation(const RowKernels* kernels) {
+    return kernels->fractal == FractalMandelbrot && kernels->power == 2;
+}
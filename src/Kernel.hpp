@@ -0,0 +1,178 @@
+#pragma once
+#include "Number.hpp"
+
+
+// Simple complex number struct consisting of two numbers, being the real and the
+// imaginary part. Number is float, double, DoubleDouble or QuadDouble.
+template <typename Number>
+struct Complex {
+    Number real;
+    Number imag;
+};
+
+
+// Initialize complex number by defining its real and imaginary part.
+template <typename Number>
+void initComplex(Complex<Number> *complex, Number real, Number imag) {
+    complex->real = real;
+    complex->imag = imag;
+}
+
+
+// The absolute value of a complex number, being the distance from (0, 0) in the plain.
+template <typename Number>
+Number absSquared(Complex<Number> *complex);
+
+
+// Square a complex number.
+template <typename Number>
+Complex<Number> squareComplex(Complex<Number> *complex);
+
+
+// Add two complex numbers.
+template <typename Number>
+Complex<Number> addComplex(Complex<Number> *a, Complex<Number> *b);
+
+
+// The fractals the kernels iterate, both by z^power + c. Mandelbrot sets (Multibrot sets
+// for powers above 2) start at z = 0 with c being the pixel, Julia sets start at z being
+// the pixel with the same c for the whole frame.
+enum Fractal {
+    FractalMandelbrot,
+    FractalJulia
+};
+
+
+// Powers z can be raised to. Every fractal and power has kernels of its own, with the
+// power multiplied out at compile time.
+const int minPower = 2;
+const int maxPower = 8;
+
+
+// Run the "mandelbrot sequence" on given complex number until it explodes or the amount
+// of max loops is reached. With interiorChecks, pixels detected to be inside the set
+// (main cardioid, period-2 bulb or an orbit that runs into a cycle) return max loops
+// without iterating all the way.
+template <typename Number>
+int mandelbrot(Complex<Number> *c, int maxLoops, bool interiorChecks);
+
+
+// Whether the "mandelbrot sequence" of a pixel is decided yet. A running pixel only
+// stopped because it ran into max loops.
+enum OrbitStatus : char {
+    OrbitRunning,
+    OrbitEscaped,
+    OrbitInside
+};
+
+
+// Where the "mandelbrot sequence" of a pixel stopped: its last value and the point saved
+// for cycle detection. Together with the amount of loops this is everything mandelbrot()
+// keeps while iterating, so a running pixel can be continued with more max loops later
+// and ends up exactly where iterating it from the start would have.
+template <typename Number>
+struct Orbit {
+    Complex<Number> z;
+    Complex<Number> saved;
+    OrbitStatus status;
+};
+
+
+// Continue the "mandelbrot sequence" of c that already did loops loops and stopped at
+// orbit, until it explodes, is found to be inside the set or max loops is reached.
+// Updates orbit and returns the new amount of loops. With loops = 0 and an orbit of all
+// zeros this is the same as mandelbrot().
+template <typename Number>
+int continueMandelbrot(Complex<Number> *c, int loops, int maxLoops, bool interiorChecks,
+                       Orbit<Number> *orbit);
+
+
+// What the kernels of a frame need besides the pixels: the c of Julia sets, and the
+// squared radius past which their orbits explode, at least 4 and more for |c| > 2. Orbits
+// of Mandelbrot sets always explode past 2, which the kernels know at compile time.
+template <typename Number>
+struct KernelConstants {
+    Complex<Number> julia = {Number(0), Number(0)};
+    double escapeRadius2 = 4;
+};
+
+
+// Runs the sequence of the fractal on count pixels (cReal[i], cImag[i]) and writes the
+// amount of loops of each pixel into loops. The pixels are usually a row that shares the
+// same imaginary part, but can be any line of pixels, like a column. If orbits isn't
+// nullptr, the orbit every pixel stopped at is written there as well.
+template <typename Number>
+using RowKernelFunction = void (*)(const Number* cReal, const Number* cImag, int count,
+                                   int maxLoops, bool interiorChecks,
+                                   const KernelConstants<Number>* constants, int* loops,
+                                   Orbit<Number>* orbits);
+
+
+// Continues the sequence of the fractal on pixel c that already did loops loops and
+// stopped at orbit, like continueMandelbrot() does for the Mandelbrot set.
+template <typename Number>
+using ResumeFunction = int (*)(Complex<Number>* c, int loops, int maxLoops,
+                               bool interiorChecks, const KernelConstants<Number>* constants,
+                               Orbit<Number>* orbit);
+
+
+// A row kernel of one fractal and power with the constants of the frame, called like a
+// function on a row of pixels, see RowKernelFunction. All kernels of a number type return
+// exactly the same amount of loops for every pixel, the ones of the Mandelbrot set with
+// power 2 the same as mandelbrot() does. resume() continues an orbit a row kernel wrote.
+template <typename Number>
+struct RowKernel {
+    RowKernelFunction<Number> run;
+    ResumeFunction<Number> resumeOrbit;
+    KernelConstants<Number> constants;
+
+    void operator()(const Number* cReal, const Number* cImag, int count, int maxLoops,
+                    bool interiorChecks, int* loops, Orbit<Number>* orbits) const {
+        run(cReal, cImag, count, maxLoops, interiorChecks, &constants, loops, orbits);
+    }
+
+    int resume(Complex<Number>* c, int loops, int maxLoops, bool interiorChecks,
+               Orbit<Number>* orbit) const {
+        return resumeOrbit(c, loops, maxLoops, interiorChecks, &constants, orbit);
+    }
+};
+
+
+// The row kernels of one instruction set and fractal, one per number type. The extended
+// precision types have no SIMD version and always use the scalar kernel.
+struct RowKernels {
+    const char* name;
+    RowKernel<float> floatKernel;
+    RowKernel<double> doubleKernel;
+    RowKernel<DoubleDouble> doubleDoubleKernel;
+    RowKernel<QuadDouble> quadDoubleKernel;
+    Fractal fractal;
+    int power;
+    // whether pixels mirrored across the real axis always get the same loops, which only
+    // doesn't hold for Julia sets of a c off the real axis
+    bool conjugateSymmetric;
+};
+
+
+// Pick the widest row kernels the CPU we are running on supports, for the Mandelbrot set.
+RowKernels detectRowKernels();
+
+
+struct BigComplex;
+
+
+// Switch the row kernels over to the fractal with z raised to power, from minPower to
+// maxPower, keeping their instruction set. julia is the c of Julia sets, it is rounded to
+// every number type and ignored for Mandelbrot sets. The kernels are looked up in a table
+// of all fractals and powers, so nothing is decided per loop.
+void selectFractal(RowKernels* kernels, Fractal fractal, int power, const BigComplex* julia);
+
+
+// Whether frames of the fractal can be rendered with perturbation, which is only written
+// for the Mandelbrot set with power 2.
+bool hasPerturbation(const RowKernels* kernels);
+
+
+// Look up row kernels by name ("scalar", "avx2" or "avx512"), for the Mandelbrot set.
+// Returns false if the name is unknown or the CPU does not support the instruction set.
+bool findRowKernels(const char* name, RowKernels* kernels);
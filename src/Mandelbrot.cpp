@@ -7,225 +7,175 @@
 #include <vector>
 #include <sstream>
 #include <iomanip>
-#include <cstring>
-
-
-// Simple complex number struct consisting of two doubles, being the real and the
-// imaginary part.
-struct Complex {
-    double real;
-    double imag;
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "Viewport.hpp"
+#include "Precision.hpp"
+#include "RenderThread.hpp"
+#include "Render.hpp"
+#include "Options.hpp"
+#include "Headless.hpp"
+#include "Bench.hpp"
+#include "Poster.hpp"
+#include "Farm.hpp"
+#include "Output.hpp"
+#include "FrameWriter.hpp"
+#include "Trace.hpp"
+#include "TileCache.hpp"
+
+
+// The latest pass of the frame that is rendered in the background, handed over from
+// the render thread to the event loop.
+struct PassHandover {
+    std::mutex mutex;
+    FrameBuffer frameBuffer;
+    FrameStats stats;
+    // frameCounter at the time the frame was requested
+    uint32_t frame = 0;
+    bool ready = false;
 };
 
 
-// Initialize complex number by defining its real and imaginary part.
-void initComplex(struct Complex *complex, double real, double imag) {
-    complex->real = real;
-    complex->imag = imag;
-}
-
-
-// The absolute value of a complex number, being the distance from (0, 0) in the plain.
-// Calculating SQUARED distance value sqrt(a^2+b^2)^2 = abs(a^2+b^2) instead of normal
-// distance value sqrt(a^2+b^2) for efficiency.
-double absSquared(Complex *complex) {
-    return abs(complex->real * complex->real + complex->imag * complex->imag);
-}
-
-
-// Square a complex number.
-Complex squareComplex(Complex *complex) {
-    Complex newComplex;
-    double real = complex->real * complex->real - complex->imag * complex->imag;
-    double imag = 2 * complex->real * complex->imag;
-    initComplex(&newComplex, real, imag);
-    return newComplex;
-}
-
-
-// Add two complex numbers.
-Complex addComplex(Complex *a, Complex *b) {
-    Complex c;
-    initComplex(&c, a->real + b->real, a->imag + b->imag);
-    return c;
-}
-
-
-// Run the "mandelbrot sequence" on given complex number until it explodes or the amount
-// of max loops is reached.
-int mandelbrot(Complex *c, int maxLoops) {
-    int amountLoops = 0;
-    Complex sumSequence;
-    initComplex(&sumSequence, 0, 0);
-    // normally the value "explodes" when abs >= 2, but because we have squared abs,
-    // we abort if it gets >= 4 okayge.
-    while (amountLoops < maxLoops && absSquared(&sumSequence) < 4) {
-        Complex squared = squareComplex(&sumSequence);
-        sumSequence = addComplex(&squared, c);
-        amountLoops++;
-    }
-    return amountLoops;
-}
-
-
-// Converts HSV values to an sf::Color in RGB space
-sf::Color hsvToRgb(float h, float s, float v) {
-    float c = v * s; // Chroma
-    float x = c * (1 - std::fabs(std::fmod(h / 60.0f, 2) - 1));
-    float m = v - c;
-
-    float r, g, b;
-    if (h < 60) {r = c; g = x; b = 0; }
-    else if (h < 120){ r = x; g = c; b = 0; }
-    else if (h < 180){ r = 0; g = c; b = x; }
-    else if (h < 240){ r = 0; g = x; b = c; }
-    else if (h < 300){ r = x; g = 0; b = c; }
-    else             { r = c; g = 0; b = x; }
-
-    return sf::Color(
-        static_cast<sf::Uint8>((r + m) * 255),
-        static_cast<sf::Uint8>((g + m) * 255),
-        static_cast<sf::Uint8>((b + m) * 255)
-    );
-}
-
-
-sf::Color color(int i, int maxI) {
-    if (i >= maxI) {
-        return sf::Color::Black; // Inside the set
+// Take over the latest pass of the given frame if there is a new one, by swapping it
+// into the frame buffer shown by the event loop. Passes of older frames that were
+// cancelled too late are dropped. Returns false if there was nothing to take over.
+bool takePass(PassHandover* handover, uint32_t frame, FrameBuffer* frameBuffer,
+              FrameStats* stats) {
+    std::lock_guard<std::mutex> lock(handover->mutex);
+    if (!handover->ready) {
+        return false;
     }
-
-    // Normalized progress (0 to 1)
-    float t = static_cast<float>(i) / 500;
-
-    // Apply nonlinear transformation to compress high values
-    t = std::pow(t, 0.9f); // (0.5 = strong stretch, 1.0 = linear)
-
-    // Repeat hue multiple times
-    float hue = fmod(360.0f * t * 1.2f, 360.0f);
-
-    float saturation = 0.8f;
-    float value = 0.9f;
-
-    return hsvToRgb(hue, saturation, value);
-}
-
-
-// Calculate the color of a given pixel (x, y) by finding its complex value using the
-// upperLeft and lowerRight complex number anchors and the width and height of the
-// window, then running the "mandelbrot sequence" on it and calculating the color by the
-// amount of loops mandelbrot() returns.
-sf::Color getPixelColor(int x, int y, const Complex* upperLeft, const Complex* lowerRight,
-                        int width, int height, int maxI) {
-    Complex c;
-    double ratioX = (double)x / width;
-    double ratioY = (double)y / height;
-    initComplex(&c, upperLeft->real + (ratioX * (lowerRight->real - upperLeft->real)),
-                    upperLeft->imag + (ratioY * (lowerRight->imag - upperLeft->imag)));
-    return color(mandelbrot(&c, maxI), maxI);
-}
-
-
-// Compute rows of pixel in an interleaved pattern for better performance
-void computeRowsInterleaved(int threadId, int threadCount, int width, int height,
-    const Complex& upperLeft, const Complex& lowerRight, int maxI,
-    std::vector<std::vector<sf::Color>>& rowBuffer) {
-    // rows are allocated in a module sense, so if there are f.e. 3 workers,
-    // worker one will get row 1, 4, 7,... and the other workers accordingly
-    for (int y = threadId; y < height; y += threadCount) {
-        for (int x = 0; x < width; ++x) {
-            sf::Color color = getPixelColor(x, y, &upperLeft, &lowerRight,
-                                            width, height, maxI);
-            rowBuffer[y][x] = color;
-        }
+    handover->ready = false;
+    if (handover->frame != frame) {
+        return false;
     }
+    std::swap(frameBuffer->pixels, handover->frameBuffer.pixels);
+    (*stats) = handover->stats;
+    return true;
 }
 
 
-// Divide the rows that are to be computed and allocate them to the workers
-void divideAndConquer(const Complex* upperLeft, const Complex* lowerRight,
-                            int width, int height, int maxI,
-                            sf::Image* image) {
-    // number of threads based on CPU cores
-    const int threadCount = std::thread::hardware_concurrency();
-    std::vector<std::thread> threads;
+// Milliseconds the event loop spent on the frame shown last once it was rendered, and the
+// frame rate over the last frames.
+struct PhaseTimes {
+    double mergeMs = 0;
+    double saveMs = 0;
+    double uploadMs = 0;
+    double displayMs = 0;
+    double fps = 0;
+    // when the last frames were done
+    std::deque<std::chrono::steady_clock::time_point> frameTimes;
+};
 
-    // create a 2D buffer for all pixels, initialized with the correct size
-    std::vector<std::vector<sf::Color>> rowBuffer(height, std::vector<sf::Color>(width));
 
-    // divide work among worker
-    for (int i = 0; i < threadCount; ++i) {
-        threads.emplace_back(computeRowsInterleaved, i, threadCount, width, height,
-                             std::cref(*upperLeft), std::cref(*lowerRight), maxI,
-                            std::ref(rowBuffer));
-    }
+// Frames the frame rate is averaged over.
+const size_t fpsFrames = 30;
 
-    // wait for all threads to finish
-    for (auto& thread : threads) {
-        thread.join();
-    }
 
-    // merge all pixel rows into an image
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            (*image).setPixel(x, y, rowBuffer[y][x]);
-        }
+// Milliseconds since a phase of the event loop started, which is also recorded into the
+// trace if there is one.
+double endPhase(Trace* trace, const char* name,
+                std::chrono::steady_clock::time_point start) {
+    double milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    if (trace) {
+        double end = trace->now();
+        trace->event(name, traceMainLane, end - 1000 * milliseconds, end);
     }
+    return milliseconds;
 }
 
 
-// Zoom into the position of the cursor by zoomFactor by moving the upperLeft and
-// lowerRight complex number anchors towards the cursor position by zoomFactor of
-// their distance.
-void zoomInCursor(int x, int y, Complex *upperLeft, Complex *lowerRight,
-                    int width, int height, double zoomFactor) {
-    Complex position;
-    double ratioX = (double)x / width;
-    double ratioY = (double)y / height;
-    initComplex(&position, upperLeft->real + (ratioX * (lowerRight->real - upperLeft->real)),
-                    upperLeft->imag + (ratioY * (lowerRight->imag - upperLeft->imag)));
-    upperLeft->real = upperLeft->real + (zoomFactor * (position.real - upperLeft->real));
-    upperLeft->imag = upperLeft->imag + (zoomFactor * (position.imag - upperLeft->imag));
-    lowerRight->real = lowerRight->real + (zoomFactor * (position.real - lowerRight->real));
-    lowerRight->imag = lowerRight->imag + (zoomFactor * (position.imag - lowerRight->imag));
+// Count a finished frame into the rolling frame rate.
+void countFrame(PhaseTimes* phases) {
+    phases->frameTimes.push_back(std::chrono::steady_clock::now());
+    if (phases->frameTimes.size() > fpsFrames) {
+        phases->frameTimes.pop_front();
+    }
+    double seconds = std::chrono::duration<double>(phases->frameTimes.back()
+                                                   - phases->frameTimes.front()).count();
+    phases->fps = seconds > 0 ? (phases->frameTimes.size() - 1) / seconds : 0;
 }
 
 
-// Zoom into the auto zoom target coordinates by zoomFactor by moving the upperLeft and
-// lowerRight complex number anchors towards the cursor position by zoomFactor of their
-// distance.
-void zoomInAuto(Complex *target, Complex *upperLeft, Complex *lowerRight, double zoomFactor) {
-    upperLeft->real = upperLeft->real + (zoomFactor * (target->real - upperLeft->real));
-    upperLeft->imag = upperLeft->imag + (zoomFactor * (target->imag - upperLeft->imag));
-    lowerRight->real = lowerRight->real + (zoomFactor * (target->real - lowerRight->real));
-    lowerRight->imag = lowerRight->imag + (zoomFactor * (target->imag - lowerRight->imag));
+// Amount of decimal digits needed to print coordinates of the viewport down to the
+// pixel, but at least the 16 digits of a double.
+int coordinateDigits(const Viewport* viewport, int width) {
+    return std::max(16, static_cast<int>(-pixelSpacingExp(viewport, width) * 0.30103) + 3);
 }
 
 
 // update debug text containing the coordinates of the cursor as (real, imag) and
 // update the backgroud text box
-void updateTextRender(Complex *upperLeft, Complex *lowerRight, sf::Text* debugText,
+void updateTextRender(const Viewport *viewport, sf::Text* debugText,
                         sf::FloatRect* textBounds, sf::RectangleShape* background,
-                        double* mouseReal, double* mouseImag, int mouseX, int mouseY,
+                        BigComplex* mouse, int mouseX, int mouseY,
                         int windowWidth, int windowHeight, int maxI, double zoomFactor,
-                        bool save, bool zoom, bool screenshot, int width, int height) {
+                        bool save, bool zoom, bool screenshot, int width, int height,
+                        const char* kernelName, Precision precision,
+                        const char* paletteName, const FrameStats* stats,
+                        const PhaseTimes* phases) {
     
     // compute real and imag coordinates of cursor
-    (*mouseReal) = upperLeft->real + ((static_cast<double>(mouseX) /
-                    static_cast<double>(windowWidth))
-                    * (lowerRight->real - upperLeft->real));
-    (*mouseImag) = upperLeft->imag + ((static_cast<double>(mouseY) /
-                    static_cast<double>(windowHeight))
-                    * (lowerRight->imag - upperLeft->imag));
+    pixelToComplex(viewport, mouseX, mouseY, windowWidth, windowHeight, mouse);
+    int digits = coordinateDigits(viewport, width);
     
     // write into debug text
     std::ostringstream cords;
-    cords << std::fixed << std::setprecision(16) << (*mouseReal) << "\n"
-            << std::fixed << std::setprecision(16) << (*mouseImag) << "\n"
+    cords << std::fixed << std::setprecision(digits) << mouse->real << "\n"
+            << std::fixed << std::setprecision(digits) << mouse->imag << "\n"
             << "Width: " << width << " | Height: " << height << "\n"
-            << "Max iterations: " << maxI << "\n" <<
+            << "Max iterations: " << maxI << " | Kernel: " << kernelName << "\n" <<
             "Zoom factor: " << std::fixed << std::setprecision(3) << zoomFactor << "\n"
-            << "Autozoom: " << zoom << " | Saving: " << save;
+            << "Autozoom: " << zoom << " | Saving: " << save << "\n"
+            << "Palette: " << paletteName << "\n"
+            << "Precision: " << precisionName(precision);
+    if (precision == PrecisionPerturbation) {
+        cords << " | Skipped iterations: " << stats->skipped;
+    }
+    if (stats->subdivided) {
+        double total = std::max(1L, stats->computedPixels + stats->filledPixels);
+        cords << "\nComputed: " << std::fixed << std::setprecision(1)
+              << 100 * stats->computedPixels / total << "% | Filled: "
+              << 100 * stats->filledPixels / total << "%";
+    }
+    if (stats->reprojected) {
+        cords << "\nReused: " << std::fixed << std::setprecision(1)
+              << 100.0 * stats->reusedPixels / (static_cast<double>(width) * height) << "%";
+    }
+    if (stats->mirroredPixels > 0) {
+        cords << "\nMirrored: " << std::fixed << std::setprecision(1)
+              << 100.0 * stats->mirroredPixels / (static_cast<double>(width) * height)
+              << "% of the pixels";
+    }
+    if (stats->continued) {
+        cords << "\nContinued: " << std::fixed << std::setprecision(1)
+              << 100.0 * stats->continuedPixels / (static_cast<double>(width) * height)
+              << "% of the pixels";
+    }
+    if (stats->cached) {
+        cords << "\nCached: " << stats->cachedTiles << " tiles | Iterated: "
+              << stats->computedTiles << " tiles";
+    }
+    if (stats->antialiased) {
+        cords << "\nAnti-aliased: " << std::fixed << std::setprecision(1)
+              << 100.0 * stats->antialiasedPixels / (static_cast<double>(width) * height)
+              << "% of the pixels | " << stats->antialiasSamples << " samples | "
+              << stats->antialiasMs << " ms";
+    }
+    if (stats->step > 1) {
+        cords << "\nRendering: 1/" << stats->step << " resolution";
+    }
+    cords << std::fixed << std::setprecision(1) << "\nFps: " << phases->fps
+          << " | Compute: " << stats->computeMs << " ms | Colorize: " << stats->colorizeMs
+          << " ms\nMerge: " << phases->mergeMs << " ms | Upload: " << phases->uploadMs
+          << " ms | Save: " << phases->saveMs << " ms | Display: " << phases->displayMs
+          << " ms\nIterations: " << stats->loops / 1e6 << " M | Imbalance: "
+          << std::setprecision(2) << loadImbalance(stats);
 
     if (screenshot) {
         cords << "\nScreenshot saved.";
@@ -243,78 +193,80 @@ void updateTextRender(Complex *upperLeft, Complex *lowerRight, sf::Text* debugTe
 
 
 int main(int argc, char* argv[]) {
-    int width = 1280;
-    int height = 720;
+    Options options;
+    parseOptions(argc, argv, &options);
+    if (options.bench) {
+        return runBench(&options);
+    }
+    if (options.farmPort > 0) {
+        return runFarmCoordinator(&options);
+    }
+    if (!options.farmAddress.empty()) {
+        return runFarmWorker(&options);
+    }
+    if (options.headless) {
+        return runHeadless(&options);
+    }
+    if (!options.posterPath.empty()) {
+        return runPoster(&options);
+    }
+
+    const int width = options.width;
+    const int height = options.height;
 
     int mouseX;
     int mouseY;
     int windowWidth;
     int windowHeight;
-    double mouseReal;
-    double mouseImag;
+    BigComplex mouse;
     int mouseOldX = -1;
     int mouseOldY = -1;
 
-    int maxI = 100;
+    int maxI = options.maxI;
     bool update = true;
     bool updateText = true;
     bool sharpen = false;
     bool blur = false;
-    bool autoZoom = false;
-    bool saveFrames = false;
-    bool fullscreen = false;
-    bool renderText = false;
+    bool autoZoom = options.autoZoom;
+    const bool saveFrames = options.saveFrames;
+    bool fullscreen = options.fullscreen;
+    bool renderText = options.renderText;
     bool screenShot = false;
+    bool zoomClick = false;
     uint32_t frameCounter = 0;
-    int maxFrames = -1;
-    double zoomFactor = 0.1;
-
-    Complex upperLeft;
-    Complex lowerRight;
-    Complex autoZoomTarget; // horsesea valley
-    initComplex(&upperLeft, -2.5, 1);
-    initComplex(&lowerRight, 1, -1);
-    initComplex(&autoZoomTarget, -0.7435862898659100, 0.1318763829122250);
-
-    std::string helpText = "Give no optional arguments for a 1280x720 rendering.\n\nUse LMB to zoom into the position of the cursor, press SPACE to toggle auto zoom, f to toggle fullscreen and t to toggle debug text. Press s to take a screenshot.\n\nUse:\n-r WIDTH HEIGHT for custom resolution (anything different from 16:9 will be distorted!) [Standard 1280 720]\n-c REAL IMAG for custom zoom coordinates [Standard -0.7435... 0.1318...]\n-m MAX for a maximum amount of frames before the program auto closes [Standard -1]\n-a to enable auto zoom from the beginning\n-s to save the frames as png's in /frames\n-i MAXI to change the maximum amount of iterations before a pixel is considered black [Standard 100]\n-z ZOOMFACTOR to change how much to zoom in for each new frame [Standard 0.1]\n-f to enable fullscreen at startup\n-t to enable debug text at startup\n";
-
-    // parse optional terminal arguments
-    for (int i = 1; i < argc; i++) {
-        if (std::strcmp(argv[i], "-r") == 0) {
-            width = std::atoi(argv[i + 1]);
-            height = std::atoi(argv[i + 2]);
-            i++;
-            i++;
-        } else if (std::strcmp(argv[i], "-h") == 0) {
-            std::cout << helpText;
-            exit(0);
-        } else if (std::strcmp(argv[i], "-m") == 0) {
-            maxFrames = std::atoi(argv[i + 1]);
-            i++;
-        } else if (std::strcmp(argv[i], "-a") == 0) {
-            autoZoom = true;
-        } else if (std::strcmp(argv[i], "-s") == 0) {
-            saveFrames = true;
-        } else if (std::strcmp(argv[i], "-i") == 0) {
-            maxI = std::atoi(argv[i + 1]);
-            i++;
-        } else if (std::strcmp(argv[i], "-z") == 0) {
-            zoomFactor = std::atof(argv[i + 1]);
-            i++;
-        } else if (std::strcmp(argv[i], "-f") == 0) {
-            fullscreen = true;
-        } else if (std::strcmp(argv[i], "-t") == 0) {
-            renderText = true;
-        } else if (std::strcmp(argv[i], "-c") == 0) {
-            autoZoomTarget.real = std::atof(argv[i + 1]);
-            autoZoomTarget.imag = std::atof(argv[i + 2]);
-            i++;
-            i++;
-        } else {
-            std::cout << helpText;
-            exit(0);
-        }
+    const int maxFrames = options.maxFrames;
+    const int frameDigitCount = frameDigits(maxFrames);
+    const double zoomFactor = options.zoomFactor;
+
+    const bool autoPrecision = options.autoPrecision;
+    const bool seriesApproximation = options.seriesApproximation;
+    const bool interiorChecks = options.interiorChecks;
+    Precision precision = options.precision;
+    const bool subdivision = options.subdivision;
+    const Antialiasing& antialiasing = options.antialiasing;
+    const IterationBudget& budget = options.budget;
+    const bool reuse = options.reuse;
+    Reprojection reprojection;
+    reprojection.tolerance = options.tolerance;
+    // p switches between the built-in palette and the one loaded with -l
+    const std::vector<Palette>& palettes = options.palettes;
+    size_t paletteIndex = options.paletteIndex;
+    FrameStats frameStats;
+    const RowKernels& rowKernels = options.rowKernels;
+
+    Viewport viewport = options.viewport;
+    BigComplex autoZoomTarget = options.target;
+
+    // declared before the pool, so it is only written once the workers are gone
+    std::unique_ptr<Trace> trace;
+    if (!options.tracePath.empty()) {
+        trace.reset(new Trace(options.tracePath));
     }
+    PhaseTimes phases;
+
+    // the workers live as long as the program and render every frame
+    ThreadPool pool(options.threadCount);
+    pool.setTrace(trace.get());
 
     // initiate renderer
     sf::VideoMode desktopFull = sf::VideoMode::getDesktopMode();
@@ -327,9 +279,49 @@ int main(int argc, char* argv[]) {
         window.setPosition(sf::Vector2i(0, 0));
     }
 
+    // the frame buffer the workers render into and the texture it is uploaded to, both
+    // allocated once and reused for every frame
+    FrameBuffer frameBuffer;
+    allocFrameBuffer(&frameBuffer, width, height);
+    sf::Texture texture;
+    texture.create(width, height);
+    texture.setSmooth(true);
+    sf::Sprite sprite;
+    sprite.setTexture(texture);
+    // amount of loops of every pixel of the last frame, which is colored from them with
+    // the table of the current palette and max loops
+    std::vector<int> iterations;
+    LastFrame lastFrame;
+    ColorTable colorTable;
+    // saves frames in the background while the next ones render, and finishes writing
+    // them when the program closes
+    FrameWriter frameWriter(options.encoders, options.pngLevel);
+    // every finished frame is also streamed as video, if asked for
+    std::unique_ptr<FrameWriter> streamWriter;
+    if (!options.streamPath.empty()) {
+        streamWriter.reset(new FrameWriter(options.streamFormat,
+                                           openStream(options.streamPath),
+                                           options.encoders));
+    }
+
+    // frames are put together from the tiles in here if there is a cache, and only
+    // rendered as usual where it can't be used
+    std::unique_ptr<TileCache> cache;
+    if (!options.cachePath.empty()) {
+        cache.reset(new TileCache(options.cachePath, options.cacheMegabytes << 20));
+    }
+
+    // frames requested outside of auto zoom are rendered progressively on a thread of
+    // their own, into a frame buffer of their own, and every pass is handed over to here
+    FrameBuffer progressiveBuffer;
+    allocFrameBuffer(&progressiveBuffer, width, height);
+    PassHandover handover;
+    allocFrameBuffer(&handover.frameBuffer, width, height);
+    bool rendering = false;
+    // declared last, so it stops before anything its frames use goes away
+    RenderThread renderThread;
+
     // initiate screen scaling for fullscreen
-    sf::Image image;
-    image.create(width, height);
     int screenWidth = desktopFull.width;
     int screenHeight = desktopFull.height;
     double scaleX = static_cast<double>(screenWidth) / width;
@@ -387,7 +379,8 @@ int main(int argc, char* argv[]) {
                     if (autoZoom) {
                         update = true;
                     } else {
-                        update = false;
+                        // a frame that reused pixels is rendered again exactly
+                        update = frameStats.reusedPixels > 0;
                         updateText = true;
                     }
                 }
@@ -413,6 +406,11 @@ int main(int argc, char* argv[]) {
                     
                     update = true;
                 }
+                // p switches the palette, which only colors the frame again
+                if (event.key.code == 15 && palettes.size() > 1) {
+                    paletteIndex = (paletteIndex + 1) % palettes.size();
+                    update = true;
+                }
                 // s takes a screenshot
                 if (event.key.code == 18) {
                     if (!saveFrames) {
@@ -424,6 +422,11 @@ int main(int argc, char* argv[]) {
                     window.close();
                 }
             }
+            // a new click zooms in right away, even while the last frame is still rendering
+            if (event.type == sf::Event::MouseButtonPressed
+                && event.mouseButton.button == sf::Mouse::Left) {
+                zoomClick = true;
+            }
             // probably not needed but oh well
             if (event.type == sf::Event::KeyReleased) {
                 if (event.key.code == 47) {
@@ -460,15 +463,15 @@ int main(int argc, char* argv[]) {
 
         // don't need to update render for screenshot
         if (screenShot) {
-            std::ostringstream filename;
-            filename << "frames/frame_" << std::setw(4) << std::setfill('0')
-                        << frameCounter << ".png";
-            image.saveToFile(filename.str());
-            std::cout << "Saved screenshot to: " << filename.str() << "\n";
+            std::string filename = frameFilename(frameCounter, frameDigitCount);
+            frameWriter.save(&frameBuffer, filename);
+            std::cout << "Saving screenshot to: " << filename << "\n";
             screenShot = false;
         }
 
         // update rendering
+        bool frameDone = false;
+        bool passDone = false;
         if (update) {
             frameCounter++;
             //if (frameCounter % 1 == 0) {
@@ -476,37 +479,140 @@ int main(int argc, char* argv[]) {
             //}
 
             // main mandelbrot update logic
-            divideAndConquer(&upperLeft, &lowerRight, width, height, maxI, &image);
+            if (autoPrecision) {
+                precision = choosePrecision(&viewport, width, hasPerturbation(&rowKernels));
+            }
+            if (autoZoom) {
+                // auto zoom needs every frame complete before it zooms on, so it renders
+                // them right here, with the pool to itself
+                renderThread.cancel();
+                rendering = false;
+                updateColorTable(&colorTable, &palettes[paletteIndex], maxI);
+                double renderStart = trace ? trace->now() : 0;
+                if (!cache || !renderCached(&pool, cache.get(), &viewport, width, height,
+                                            maxI, interiorChecks, &rowKernels, &iterations,
+                                            &lastFrame, &colorTable, &frameBuffer,
+                                            &frameStats, nullptr)) {
+                    divideAndConquer(&pool, &viewport, width, height, maxI, interiorChecks,
+                                     &rowKernels, precision, seriesApproximation,
+                                     subdivision, reuse ? &reprojection : nullptr,
+                                     &iterations, &lastFrame, &colorTable, &frameBuffer,
+                                     &frameStats);
+                }
+                antialiasFrame(&pool, &viewport, width, height, maxI, interiorChecks,
+                               &rowKernels, precision, seriesApproximation, &antialiasing,
+                               iterations, &colorTable, &frameBuffer, &frameStats, nullptr);
+                if (trace) {
+                    traceFrame(trace.get(), traceMainLane, renderStart, trace->now(),
+                               &frameStats);
+                }
+                frameDone = true;
+            } else {
+                // anything else is rendered progressively in the background, so the
+                // window keeps responding and the next click or key cancels the frame
+                Viewport frameViewport = viewport;
+                int frameMaxI = maxI;
+                Precision framePrecision = precision;
+                const Palette* framePalette = &palettes[paletteIndex];
+                uint32_t frame = frameCounter;
+                renderThread.submit([&, frameViewport, frameMaxI, framePrecision,
+                                     framePalette, frame](const std::atomic<bool>& cancel) {
+                    FrameStats stats;
+                    double renderStart = trace ? trace->now() : 0;
+                    updateColorTable(&colorTable, framePalette, frameMaxI);
+                    auto passDone = [&](int step) {
+                        // only the finished frame is worth anti-aliasing
+                        if (step == 1) {
+                            antialiasFrame(&pool, &frameViewport, width, height, frameMaxI,
+                                           interiorChecks, &rowKernels, framePrecision,
+                                           seriesApproximation, &antialiasing, iterations,
+                                           &colorTable, &progressiveBuffer, &stats,
+                                           &cancel);
+                            if (cancel) {
+                                return;
+                            }
+                        }
+                        std::lock_guard<std::mutex> lock(handover.mutex);
+                        copyFrameBuffer(&progressiveBuffer, &handover.frameBuffer);
+                        handover.stats = stats;
+                        handover.stats.step = step;
+                        handover.frame = frame;
+                        handover.ready = true;
+                    };
+                    if (cache && renderCached(&pool, cache.get(), &frameViewport, width,
+                                              height, frameMaxI, interiorChecks,
+                                              &rowKernels, &iterations, &lastFrame,
+                                              &colorTable, &progressiveBuffer, &stats,
+                                              &cancel)) {
+                        if (!cancel) {
+                            passDone(1);
+                        }
+                    } else {
+                        renderProgressive(&pool, &frameViewport, width, height, frameMaxI,
+                                          interiorChecks, &rowKernels, framePrecision,
+                                          seriesApproximation, subdivision, &iterations,
+                                          &lastFrame, &colorTable, &progressiveBuffer,
+                                          &stats, cancel, passDone);
+                    }
+                    if (trace && !cancel) {
+                        traceFrame(trace.get(), traceRenderLane, renderStart, trace->now(),
+                                   &stats);
+                    }
+                });
+                rendering = true;
+                update = false;
+            }
+        }
+
+        // show every pass of the frame in the background as soon as it is done
+        auto mergeStart = std::chrono::steady_clock::now();
+        if (rendering && takePass(&handover, frameCounter, &frameBuffer, &frameStats)) {
+            phases.mergeMs = endPhase(trace.get(), "merge", mergeStart);
+            passDone = true;
+            if (frameStats.step == 1) {
+                frameDone = true;
+                rendering = false;
+            }
+        }
 
+        if (frameDone || passDone) {
             // update text box logic
             if (renderText) {
-                updateTextRender(&upperLeft, &lowerRight, &debugText, &textBounds,
-                                &background, &mouseReal, &mouseImag, mouseX, mouseY,
+                updateTextRender(&viewport, &debugText, &textBounds,
+                                &background, &mouse, mouseX, mouseY,
                                 windowWidth, windowHeight, maxI, zoomFactor, saveFrames,
-                                autoZoom, false, width, height);
+                                autoZoom, false, width, height, rowKernels.name,
+                                precision, palettes[paletteIndex].name.c_str(),
+                                &frameStats, &phases);
             }
             
             // store frame as png
-            if (saveFrames) {
-                std::ostringstream filename;
-                filename << "frames/frame_" << std::setw(4) << std::setfill('0')
-                            << frameCounter << ".png";
-                image.saveToFile(filename.str());
+            if (frameDone && (saveFrames || streamWriter)) {
+                auto saveStart = std::chrono::steady_clock::now();
+                if (saveFrames) {
+                    frameWriter.save(&frameBuffer,
+                                     frameFilename(frameCounter, frameDigitCount));
+                }
+                if (streamWriter) {
+                    streamWriter->save(&frameBuffer);
+                }
+                phases.saveMs = endPhase(trace.get(), "save", saveStart);
             }
 
-            sf::Texture texture;
-            sf::Sprite sprite;
-
-            texture.loadFromImage(image);
-            texture.setSmooth(true);
-            sprite.setTexture(texture);
+            // upload the new frame into the existing texture
+            auto uploadStart = std::chrono::steady_clock::now();
+            texture.update(frameBuffer.pixels.get());
+            phases.uploadMs = endPhase(trace.get(), "upload", uploadStart);
 
             // scale sprite with dimensions (width, height) to (screenWidth, screenHeight)
             if (fullscreen) {
                 sprite.setScale(scaleX, scaleY);
+            } else {
+                sprite.setScale(1, 1);
             }
 
             // clear previous image and draw new one
+            auto displayStart = std::chrono::steady_clock::now();
             window.clear();
             window.draw(sprite);
             if (renderText) {
@@ -514,34 +620,32 @@ int main(int argc, char* argv[]) {
                 window.draw(debugText);
             }
             window.display();
-
-            if (!autoZoom) {
-                update = false;
+            phases.displayMs = endPhase(trace.get(), "display", displayStart);
+            if (frameDone) {
+                countFrame(&phases);
             }
 
-            if (maxFrames > 0 && maxFrames <= frameCounter) {
+            if (frameDone && maxFrames > 0 && maxFrames <= frameCounter) {
                 window.close();
             }
         // only update debug text, still need to draw the rest
         } else if (updateText) {  
             // update text box logic  
             if (renderText) {
-                updateTextRender(&upperLeft, &lowerRight, &debugText, &textBounds,
-                                &background, &mouseReal, &mouseImag, mouseX, mouseY,
+                updateTextRender(&viewport, &debugText, &textBounds,
+                                &background, &mouse, mouseX, mouseY,
                                 windowWidth, windowHeight, maxI, zoomFactor, saveFrames,
-                                autoZoom, false, width, height);
+                                autoZoom, false, width, height, rowKernels.name,
+                                precision, palettes[paletteIndex].name.c_str(),
+                                &frameStats, &phases);
             }
 
-            sf::Texture texture;
-            sf::Sprite sprite;
-
-            texture.loadFromImage(image);
-            texture.setSmooth(true);
-            sprite.setTexture(texture);
-            
+            // the texture still holds the last frame, no need to upload it again
             // scale sprite with dimensions (width, height) to (screenWidth, screenHeight)
             if (fullscreen) {
                 sprite.setScale(scaleX, scaleY);
+            } else {
+                sprite.setScale(1, 1);
             }
 
             // clear previous image and draw new one
@@ -553,23 +657,32 @@ int main(int argc, char* argv[]) {
             }
             window.display();
             updateText = false;
+        } else if (rendering) {
+            // nothing to do until the next pass, don't take a core away from the workers
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
 
-        // call zoom function if LMB was pressed whilst the cursor is
-        // inside the program window
-        if (sf::Mouse::isButtonPressed(sf::Mouse::Left) && !autoZoom) {
+        // call zoom function if LMB was clicked, or is held down and the last frame is
+        // done, whilst the cursor is inside the program window
+        bool zoomIn = zoomClick || (sf::Mouse::isButtonPressed(sf::Mouse::Left) && !rendering);
+        zoomClick = false;
+        if (zoomIn && !autoZoom) {
             if (mousePosition.x >= 0 && mousePosition.x < windowWidth
                 && mousePosition.y >= 0 && mousePosition.y < windowHeight) {
                 zoomInCursor(fullscreen ? mouseX / scaleX : mouseX,
                             fullscreen ? mouseY / scaleY : mouseY,
-                            &upperLeft, &lowerRight, width, height,
-                            zoomFactor);
+                            &viewport, width, height, zoomFactor);
                 update = true;
             }
         }
         // call autoZoom if enabled
         if (autoZoom) {
-            zoomInAuto(&autoZoomTarget, &upperLeft, &lowerRight, zoomFactor);
+            zoomInAuto(&autoZoomTarget, &viewport, width, zoomFactor);
+            // the next frame gets the iterations this one turned out to need
+            if (budget.adaptive && frameDone) {
+                maxI = nextMaxI(&pool, &budget, iterations, width, height, maxI, options.maxI,
+                                &viewport);
+            }
         }
     }
 
@@ -578,8 +691,9 @@ int main(int argc, char* argv[]) {
     std::cout << "Max iterations: " << maxI << "\n";
     std::ostringstream cordsReal;
     std::ostringstream cordsImag;
-    cordsReal << std::fixed << std::setprecision(16) << mouseReal;
-    cordsImag << std::fixed << std::setprecision(16) << mouseImag;
+    int digits = coordinateDigits(&viewport, width);
+    cordsReal << std::fixed << std::setprecision(digits) << mouse.real;
+    cordsImag << std::fixed << std::setprecision(digits) << mouse.imag;
     std::cout << "Mouse real: " << cordsReal.str() << "\n";
     std::cout << "Mouse imag: " << cordsImag.str() << "\n";
 
@@ -0,0 +1,259 @@
+#pragma once
+#include <cmath>
+
+
+// Extended precision number types for the iteration kernel. A double-double is the
+// unevaluated sum of two doubles and has about 106 bits of mantissa, a quad-double the
+// sum of four doubles with about 212 bits. Both only use plain double operations, so
+// they are way faster than arbitrary precision. The algorithms are the ones from the QD
+// library by Hida, Li and Bailey. They rely on exact IEEE rounding, so they must not be
+// compiled with -ffast-math or FMA contraction.
+
+
+// a + b = s + err exactly.
+inline double twoSum(double a, double b, double &err) {
+    double s = a + b;
+    double bb = s - a;
+    err = (a - (s - bb)) + (b - bb);
+    return s;
+}
+
+
+// Same as twoSum, but only valid if |a| >= |b|.
+inline double quickTwoSum(double a, double b, double &err) {
+    double s = a + b;
+    err = b - (s - a);
+    return s;
+}
+
+
+// a * b = p + err exactly.
+inline double twoProd(double a, double b, double &err) {
+    double p = a * b;
+    err = std::fma(a, b, -p);
+    return p;
+}
+
+
+struct DoubleDouble {
+    double hi;
+    double lo;
+
+    DoubleDouble() : hi(0), lo(0) {}
+    DoubleDouble(double value) : hi(value), lo(0) {}
+    DoubleDouble(double high, double low) : hi(high), lo(low) {}
+};
+
+
+inline DoubleDouble operator+(const DoubleDouble &a, const DoubleDouble &b) {
+    double t1, t2;
+    double s1 = twoSum(a.hi, b.hi, t1);
+    double s2 = twoSum(a.lo, b.lo, t2);
+    t1 += s2;
+    s1 = quickTwoSum(s1, t1, t1);
+    t1 += t2;
+    s1 = quickTwoSum(s1, t1, t1);
+    return DoubleDouble(s1, t1);
+}
+
+
+inline DoubleDouble operator-(const DoubleDouble &a) {
+    return DoubleDouble(-a.hi, -a.lo);
+}
+
+
+inline DoubleDouble operator-(const DoubleDouble &a, const DoubleDouble &b) {
+    return a + (-b);
+}
+
+
+inline DoubleDouble operator*(const DoubleDouble &a, const DoubleDouble &b) {
+    double p2;
+    double p1 = twoProd(a.hi, b.hi, p2);
+    p2 += a.hi * b.lo + a.lo * b.hi;
+    p1 = quickTwoSum(p1, p2, p2);
+    return DoubleDouble(p1, p2);
+}
+
+
+inline bool operator<(const DoubleDouble &a, double b) {
+    return a.hi < b || (a.hi == b && a.lo < 0);
+}
+
+
+inline bool operator==(const DoubleDouble &a, const DoubleDouble &b) {
+    return a.hi == b.hi && a.lo == b.lo;
+}
+
+
+// a + b + c = a + b + c, with a and b holding the two largest parts afterwards.
+inline void threeSum(double &a, double &b, double &c) {
+    double t2, t3;
+    double t1 = twoSum(a, b, t2);
+    a = twoSum(c, t1, t3);
+    b = twoSum(t2, t3, c);
+}
+
+
+// Like threeSum, but only the two largest parts are kept.
+inline void threeSum2(double &a, double &b, double &c) {
+    double t2, t3;
+    double t1 = twoSum(a, b, t2);
+    a = twoSum(c, t1, t3);
+    b = t2 + t3;
+}
+
+
+// Turn five overlapping parts into four non overlapping ones, largest first.
+inline void renormalize(double &c0, double &c1, double &c2, double &c3, double &c4) {
+    double s0, s1, s2 = 0, s3 = 0;
+    if (std::isinf(c0)) {
+        return;
+    }
+    s0 = quickTwoSum(c3, c4, c4);
+    s0 = quickTwoSum(c2, s0, c3);
+    s0 = quickTwoSum(c1, s0, c2);
+    c0 = quickTwoSum(c0, s0, c1);
+
+    s0 = quickTwoSum(c0, c1, s1);
+    if (s1 != 0) {
+        s1 = quickTwoSum(s1, c2, s2);
+        if (s2 != 0) {
+            s2 = quickTwoSum(s2, c3, s3);
+            if (s3 != 0) {
+                s3 += c4;
+            } else {
+                s2 = quickTwoSum(s2, c4, s3);
+            }
+        } else {
+            s1 = quickTwoSum(s1, c3, s2);
+            if (s2 != 0) {
+                s2 = quickTwoSum(s2, c4, s3);
+            } else {
+                s1 = quickTwoSum(s1, c4, s2);
+            }
+        }
+    } else {
+        s0 = quickTwoSum(s0, c2, s1);
+        if (s1 != 0) {
+            s1 = quickTwoSum(s1, c3, s2);
+            if (s2 != 0) {
+                s2 = quickTwoSum(s2, c4, s3);
+            } else {
+                s1 = quickTwoSum(s1, c4, s2);
+            }
+        } else {
+            s0 = quickTwoSum(s0, c3, s1);
+            if (s1 != 0) {
+                s1 = quickTwoSum(s1, c4, s2);
+            } else {
+                s0 = quickTwoSum(s0, c4, s1);
+            }
+        }
+    }
+    c0 = s0;
+    c1 = s1;
+    c2 = s2;
+    c3 = s3;
+}
+
+
+struct QuadDouble {
+    double part[4];
+
+    QuadDouble() : part{0, 0, 0, 0} {}
+    QuadDouble(double value) : part{value, 0, 0, 0} {}
+    QuadDouble(double p0, double p1, double p2, double p3) : part{p0, p1, p2, p3} {}
+};
+
+
+inline QuadDouble operator+(const QuadDouble &a, const QuadDouble &b) {
+    double t0, t1, t2, t3;
+    double s0 = twoSum(a.part[0], b.part[0], t0);
+    double s1 = twoSum(a.part[1], b.part[1], t1);
+    double s2 = twoSum(a.part[2], b.part[2], t2);
+    double s3 = twoSum(a.part[3], b.part[3], t3);
+
+    s1 = twoSum(s1, t0, t0);
+    threeSum(s2, t0, t1);
+    threeSum2(s3, t0, t2);
+    t0 = t0 + t1 + t3;
+
+    renormalize(s0, s1, s2, s3, t0);
+    return QuadDouble(s0, s1, s2, s3);
+}
+
+
+inline QuadDouble operator-(const QuadDouble &a) {
+    return QuadDouble(-a.part[0], -a.part[1], -a.part[2], -a.part[3]);
+}
+
+
+inline QuadDouble operator-(const QuadDouble &a, const QuadDouble &b) {
+    return a + (-b);
+}
+
+
+inline QuadDouble operator*(const QuadDouble &a, const QuadDouble &b) {
+    double q0, q1, q2, q3, q4, q5;
+    double p0 = twoProd(a.part[0], b.part[0], q0);
+    double p1 = twoProd(a.part[0], b.part[1], q1);
+    double p2 = twoProd(a.part[1], b.part[0], q2);
+    double p3 = twoProd(a.part[0], b.part[2], q3);
+    double p4 = twoProd(a.part[1], b.part[1], q4);
+    double p5 = twoProd(a.part[2], b.part[0], q5);
+
+    // terms in the order of eps
+    threeSum(p1, p2, q0);
+
+    // terms in the order of eps^2, six of them summed into three
+    threeSum(p2, q1, q2);
+    threeSum(p3, p4, p5);
+    double t0, t1;
+    double s0 = twoSum(p2, p3, t0);
+    double s1 = twoSum(q1, p4, t1);
+    double s2 = q2 + p5;
+    s1 = twoSum(s1, t0, t0);
+    s2 += (t0 + t1);
+
+    // terms in the order of eps^3
+    s1 += a.part[0] * b.part[3] + a.part[1] * b.part[2] + a.part[2] * b.part[1]
+          + a.part[3] * b.part[0] + q0 + q3 + q4 + q5;
+    renormalize(p0, p1, s0, s1, s2);
+    return QuadDouble(p0, p1, s0, s1);
+}
+
+
+inline bool operator<(const QuadDouble &a, double b) {
+    return a.part[0] < b || (a.part[0] == b && a.part[1] < 0);
+}
+
+
+inline bool operator==(const QuadDouble &a, const QuadDouble &b) {
+    return a.part[0] == b.part[0] && a.part[1] == b.part[1] && a.part[2] == b.part[2]
+           && a.part[3] == b.part[3];
+}
+
+
+// Mantissa bits and display name of every number type the kernel can run with.
+template <typename Number> struct NumberTraits;
+
+template <> struct NumberTraits<float> {
+    static constexpr int mantissaBits = 24;
+    static constexpr const char* name = "float";
+};
+
+template <> struct NumberTraits<double> {
+    static constexpr int mantissaBits = 53;
+    static constexpr const char* name = "double";
+};
+
+template <> struct NumberTraits<DoubleDouble> {
+    static constexpr int mantissaBits = 106;
+    static constexpr const char* name = "double-double";
+};
+
+template <> struct NumberTraits<QuadDouble> {
+    static constexpr int mantissaBits = 212;
+    static constexpr const char* name = "quad-double";
+};
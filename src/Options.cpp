@@ -0,0 +1,241 @@
+#include "Options.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+
+// The command line arguments after the program name, with every "--job FILE" replaced by
+// the options in the file, which are written just like on the command line, separated by
+// any whitespace. Everything after a # on a line is ignored.
+static std::vector<std::string> expandJobFiles(int argc, char* argv[]) {
+    std::vector<std::string> words;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--job") != 0 || i + 1 >= argc) {
+            words.push_back(argv[i]);
+            continue;
+        }
+        std::ifstream file(argv[i + 1]);
+        if (!file) {
+            std::cout << "Job file " << argv[i + 1] << " could not be read.\n";
+            exit(1);
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream lineWords(line.substr(0, line.find('#')));
+            std::string word;
+            while (lineWords >> word) {
+                words.push_back(word);
+            }
+        }
+        i++;
+    }
+    return words;
+}
+
+
+void parseOptions(int argc, char* argv[], Options* options) {
+    Complex<double> upperLeft;
+    Complex<double> lowerRight;
+    initComplex(&upperLeft, -2.5, 1.0);
+    initComplex(&lowerRight, 1.0, -1.0);
+    // horsesea valley
+    options->target.real = parseBig("-0.7435862898659100");
+    options->target.imag = parseBig("0.1318763829122250");
+
+    // the viewport is kept in high precision, so zooming isn't limited by doubles
+    initViewport(&options->viewport, &upperLeft, &lowerRight);
+
+    // use the widest SIMD instruction set available unless told otherwise
+    options->rowKernels = detectRowKernels();
+    options->palettes = {builtinPalette()};
+
+    std::string helpText = "Give no optional arguments for a 1280x720 rendering.\n\nUse LMB to zoom into the position of the cursor, press SPACE to toggle auto zoom, f to toggle fullscreen and t to toggle debug text. Press s to take a screenshot.\n\nUse:\n-r WIDTH HEIGHT for custom resolution (anything different from 16:9 will be distorted!) [Standard 1280 720]\n-c REAL IMAG for custom zoom coordinates [Standard -0.7435... 0.1318...]\n-m MAX for a maximum amount of frames before the program auto closes [Standard -1]\n-a to enable auto zoom from the beginning\n-s to save the frames as png's in /frames\n-i MAXI to change the maximum amount of iterations before a pixel is considered black [Standard 100]\n-z ZOOMFACTOR to change how much to zoom in for each new frame [Standard 0.1]\n-f to enable fullscreen at startup\n-t to enable debug text at startup\n-k KERNEL to force the iteration kernel, one of scalar, avx2 or avx512 [Standard widest supported]\n-q PRECISION to force the number type, one of float, double, double-double, quad-double or perturbation [Standard picked per frame by zoom depth, from float for shallow frames up to perturbation past double-double precision]\n-d to always render with perturbation, same as -q perturbation\n-j THREADS to set the amount of worker threads [Standard one per CPU core]\n-p to skip early iterations with series approximation when rendering with perturbation\n-n to disable the interior checks (cardioid, bulb and cycle detection) and iterate every pixel inside the set up to MAXI\n-b to render by subdividing the frame into rectangles and filling those with a uniform border without iterating (Mariani-Silver)\n-u TOLERANCE to reuse the pixels of the last frame during auto zoom wherever a column and row of it land at most TOLERANCE pixels (0 to 0.5) away from the new ones, the frame is rendered again exactly once auto zoom is stopped. Has no effect together with -b\n-l PALETTE to load a palette from a text file with one \"R G B\" color per line and an optional \"period LOOPS\" line, press p to switch between it and the built-in one\n-v REAL IMAG SPAN to start at a view centered on REAL IMAG that is SPAN wide, its height follows from the resolution [Standard -0.75 0 3.5]\n--headless to render without a window: renders -m frames zooming towards the -c coordinates by the zoom factor, saves them with -s and prints the throughput at the end\n--job FILE to read more options from a text file, written just like on the command line, a # starts a comment\n--encoders THREADS to set the amount of threads compressing saved frames while the next ones render [Standard 2]\n--png-level LEVEL to set the png compression level of saved frames, from 0 (fastest) to 9 (smallest) [Standard 6]\n--y4m PATH to stream every frame as YUV4MPEG2 video into a file or named pipe, - for stdout, e.g. into ffmpeg -i -\n--rgb PATH to stream every frame as raw RGB24 video instead, e.g. into ffmpeg -f rawvideo -pixel_format rgb24 -video_size WIDTHxHEIGHT -i -\n--trace FILE to write when every thread worked on what as Chrome trace events, to open in chrome://tracing or Perfetto\n--farm PORT to coordinate a render farm: waits for workers on the TCP port and renders -m frames of auto zoom on them like --headless, saving (-s) or streaming them in order. Has no effect together with -u\n--farm-worker HOST:PORT to render frames for the coordinator at HOST:PORT until it is done, only -k and -j of the own options are used\n--poster FILE to render the -v view at the -r resolution into a single png file without a window, in strips of 256 rows that are written while the next ones render, so images much bigger than memory can be saved, e.g. -r 32768 32768 for print. -i, -k, -q, -j, -p, -n, -b, -l, --aa and --png-level still apply\n--bench to render a fixed set of scenes without a window and print the throughput as JSON, -k, -q, -j, -n, -b and -p still apply\n--bench-runs RUNS to set how often every scene is rendered for --bench [Standard 5]\n--cache FILE to keep the loops of every frame in the file as tiles of a quadtree, like map tiles, so frames of the window and of --headless that show parts rendered before, also in earlier sessions, are put together from the cached tiles and only the missing ones are iterated. Pixels are up to 0.71 pixels off, takes precedence over -b and -u and is only used down to views about 1e-15 wide, deeper frames are rendered as usual\n--cache-size MB to set how big the cache file may get, the tiles used longest ago make room for new ones [Standard 1024]\n--aa SAMPLES to anti-alias finished frames of the window and of --headless: pixels whose iterations differ from a neighbour's by more than the threshold get up to SAMPLES samples jittered inside them, 4 first and the rest only if those don't agree, and are colored with the average. 1 turns it off [Standard 1]\n--aa-threshold LOOPS to set by how many iterations neighbouring pixels or samples may differ before a pixel is refined, a pixel inside the set next to one outside always is [Standard 2]\n--auto-iterations MAX to pick the iterations of every frame of auto zoom in the window and of --headless from the zoom depth and the frame before: they go up while pixels next to late escaping ones run into them and come down when the top half of them goes unused, never below -i plus 25 for every halving of the view or above MAX. Has no effect together with --farm\n--auto-iterations-cap PERCENT to set how many percent of the pixels may run into the iterations next to late escaping ones before they go up [Standard 0.1]\n--julia REAL IMAG to render the Julia set of c = REAL + IMAG i instead of the Mandelbrot set, the view is centered on 0 0 unless -v is given\n--power N to iterate z^N + c instead of z^2 + c, N from 2 to 8, for Multibrot sets or Julia sets of the power. Other fractals than the Mandelbrot set with power 2 are rendered down to quad-double precision without perturbation and without --cache [Standard 2]\n";
+
+    // -v needs the final resolution, so it is only applied after all options
+    bool centered = false;
+    BigComplex center;
+    mpf_class span;
+
+    // options from job files are handled as if they were given right where --job is,
+    // and the trailing nullptr stands in for argv[argc]
+    std::vector<std::string> words = expandJobFiles(argc, argv);
+    std::vector<const char*> args;
+    for (const std::string& word : words) {
+        args.push_back(word.c_str());
+    }
+    args.push_back(nullptr);
+
+    // parse optional terminal arguments
+    for (size_t i = 0; i + 1 < args.size(); i++) {
+        if (std::strcmp(args[i], "-r") == 0) {
+            options->width = std::atoi(args[i + 1]);
+            options->height = std::atoi(args[i + 2]);
+            i++;
+            i++;
+        } else if (std::strcmp(args[i], "-h") == 0) {
+            std::cout << helpText;
+            exit(0);
+        } else if (std::strcmp(args[i], "-m") == 0) {
+            options->maxFrames = std::atoi(args[i + 1]);
+            i++;
+        } else if (std::strcmp(args[i], "-a") == 0) {
+            options->autoZoom = true;
+        } else if (std::strcmp(args[i], "-s") == 0) {
+            options->saveFrames = true;
+        } else if (std::strcmp(args[i], "-i") == 0) {
+            options->maxI = std::atoi(args[i + 1]);
+            i++;
+        } else if (std::strcmp(args[i], "-z") == 0) {
+            options->zoomFactor = std::atof(args[i + 1]);
+            i++;
+        } else if (std::strcmp(args[i], "-f") == 0) {
+            options->fullscreen = true;
+        } else if (std::strcmp(args[i], "-t") == 0) {
+            options->renderText = true;
+        } else if (std::strcmp(args[i], "-k") == 0) {
+            if (!findRowKernels(args[i + 1], &options->rowKernels)) {
+                std::cout << "Kernel " << args[i + 1] << " is unknown or not supported by this CPU.\n";
+                exit(1);
+            }
+            i++;
+        } else if (std::strcmp(args[i], "-q") == 0) {
+            if (!findPrecision(args[i + 1], &options->precision)) {
+                std::cout << "Precision " << args[i + 1] << " is unknown.\n";
+                exit(1);
+            }
+            options->autoPrecision = false;
+            i++;
+        } else if (std::strcmp(args[i], "-d") == 0) {
+            options->precision = PrecisionPerturbation;
+            options->autoPrecision = false;
+        } else if (std::strcmp(args[i], "-j") == 0) {
+            options->threadCount = std::atoi(args[i + 1]);
+            i++;
+        } else if (std::strcmp(args[i], "-p") == 0) {
+            options->seriesApproximation = true;
+        } else if (std::strcmp(args[i], "-n") == 0) {
+            options->interiorChecks = false;
+        } else if (std::strcmp(args[i], "-b") == 0) {
+            options->subdivision = true;
+        } else if (std::strcmp(args[i], "-u") == 0) {
+            options->reuse = true;
+            options->tolerance = std::min(0.5, std::max(0.0, std::atof(args[i + 1])));
+            i++;
+        } else if (std::strcmp(args[i], "-l") == 0) {
+            Palette palette;
+            if (!loadPalette(args[i + 1], &palette)) {
+                std::cout << "Palette " << args[i + 1] << " could not be loaded.\n";
+                exit(1);
+            }
+            options->palettes.push_back(palette);
+            options->paletteIndex = options->palettes.size() - 1;
+            i++;
+        } else if (std::strcmp(args[i], "-v") == 0) {
+            center.real = parseBig(args[i + 1]);
+            center.imag = parseBig(args[i + 2]);
+            span = parseBig(args[i + 3]);
+            centered = true;
+            i += 3;
+        } else if (std::strcmp(args[i], "--headless") == 0) {
+            options->headless = true;
+        } else if (std::strcmp(args[i], "--encoders") == 0) {
+            options->encoders = std::max(1, std::atoi(args[i + 1]));
+            i++;
+        } else if (std::strcmp(args[i], "--png-level") == 0) {
+            options->pngLevel = std::min(9, std::max(0, std::atoi(args[i + 1])));
+            i++;
+        } else if (std::strcmp(args[i], "--y4m") == 0) {
+            options->streamPath = args[i + 1];
+            options->streamFormat = FrameY4m;
+            i++;
+        } else if (std::strcmp(args[i], "--rgb") == 0) {
+            options->streamPath = args[i + 1];
+            options->streamFormat = FrameRgb;
+            i++;
+        } else if (std::strcmp(args[i], "--trace") == 0) {
+            options->tracePath = args[i + 1];
+            i++;
+        } else if (std::strcmp(args[i], "--farm") == 0) {
+            options->farmPort = std::atoi(args[i + 1]);
+            i++;
+        } else if (std::strcmp(args[i], "--farm-worker") == 0) {
+            options->farmAddress = args[i + 1];
+            i++;
+        } else if (std::strcmp(args[i], "--poster") == 0) {
+            options->posterPath = args[i + 1];
+            i++;
+        } else if (std::strcmp(args[i], "--bench") == 0) {
+            options->bench = true;
+        } else if (std::strcmp(args[i], "--bench-runs") == 0) {
+            options->benchRuns = std::max(1, std::atoi(args[i + 1]));
+            i++;
+        } else if (std::strcmp(args[i], "--cache") == 0) {
+            options->cachePath = args[i + 1];
+            i++;
+        } else if (std::strcmp(args[i], "--cache-size") == 0) {
+            options->cacheMegabytes = std::max(1, std::atoi(args[i + 1]));
+            i++;
+        } else if (std::strcmp(args[i], "--aa") == 0) {
+            options->antialiasing.maxSamples = std::max(1, std::atoi(args[i + 1]));
+            i++;
+        } else if (std::strcmp(args[i], "--aa-threshold") == 0) {
+            options->antialiasing.threshold = std::max(0, std::atoi(args[i + 1]));
+            i++;
+        } else if (std::strcmp(args[i], "--auto-iterations") == 0) {
+            options->budget.adaptive = true;
+            options->budget.ceiling = std::max(1, std::atoi(args[i + 1]));
+            i++;
+        } else if (std::strcmp(args[i], "--auto-iterations-cap") == 0) {
+            options->budget.capPercent = std::max(0.0, std::atof(args[i + 1]));
+            i++;
+        } else if (std::strcmp(args[i], "--julia") == 0) {
+            options->fractal = FractalJulia;
+            options->julia.real = parseBig(args[i + 1]);
+            options->julia.imag = parseBig(args[i + 2]);
+            i += 2;
+        } else if (std::strcmp(args[i], "--power") == 0) {
+            options->power = std::atoi(args[i + 1]);
+            if (options->power < minPower || options->power > maxPower) {
+                std::cout << "Power " << args[i + 1] << " is not between " << minPower
+                          << " and " << maxPower << ".\n";
+                exit(1);
+            }
+            i++;
+        } else if (std::strcmp(args[i], "--job") == 0) {
+            std::cout << "Job files can't load other job files.\n";
+            exit(1);
+        } else if (std::strcmp(args[i], "-c") == 0) {
+            options->target.real = parseBig(args[i + 1]);
+            options->target.imag = parseBig(args[i + 2]);
+            i++;
+            i++;
+        } else {
+            std::cout << helpText;
+            exit(0);
+        }
+    }
+
+    selectFractal(&options->rowKernels, options->fractal, options->power, &options->julia);
+    if (!hasPerturbation(&options->rowKernels)) {
+        if (!options->autoPrecision && options->precision == PrecisionPerturbation) {
+            std::cout << "Perturbation only works for the Mandelbrot set with power 2.\n";
+            exit(1);
+        }
+        // Julia and Multibrot sets are centered on the origin, and the Multibrot sets of
+        // odd powers are as tall as they are wide
+        if (!centered) {
+            center.real = 0;
+            center.imag = 0;
+            span = options->fractal == FractalJulia ? 3.5 : 5;
+            centered = true;
+        }
+    }
+
+    if (centered) {
+        initViewportCentered(&options->viewport, &center, span, options->width,
+                             options->height);
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Kernel.hpp"
+#include "Viewport.hpp"
+#include "Precision.hpp"
+#include "Palette.hpp"
+#include "Output.hpp"
+#include "Antialias.hpp"
+#include "Budget.hpp"
+
+
+// Everything that can be set on the command line or in a job file, as it is when the
+// program starts. The frontends take it from there.
+struct Options {
+    int width = 1280;
+    int height = 720;
+    int maxI = 100;
+    // frames before the program closes, -1 for no limit
+    int maxFrames = -1;
+    double zoomFactor = 0.1;
+    bool autoZoom = false;
+    bool saveFrames = false;
+    // threads compressing saved frames and their zlib level, see FrameWriter
+    int encoders = 2;
+    int pngLevel = 6;
+    // where every frame is streamed to as video, "-" for stdout, empty for nowhere
+    std::string streamPath;
+    FrameFormat streamFormat = FrameY4m;
+    // where the timeline of all frames is written as Chrome trace events, empty for no
+    // trace
+    std::string tracePath;
+    bool fullscreen = false;
+    bool renderText = false;
+    // render without a window, see runHeadless()
+    bool headless = false;
+    // coordinate a render farm on this TCP port if above 0, see runFarmCoordinator(), or
+    // render for the coordinator at host:port if not empty, see runFarmWorker()
+    int farmPort = 0;
+    std::string farmAddress;
+    // render a single image in strips into this png file if not empty, see runPoster()
+    std::string posterPath;
+    // render the benchmark scenes this many times each, see runBench()
+    bool bench = false;
+    int benchRuns = 5;
+
+    bool autoPrecision = true;
+    Precision precision = PrecisionDouble;
+    bool seriesApproximation = false;
+    bool interiorChecks = true;
+    bool subdivision = false;
+    // file the loops are cached in as tiles, see TileCache, empty for no cache, and how
+    // big it may get
+    std::string cachePath;
+    size_t cacheMegabytes = 1024;
+    // extra samples for the pixels of finished frames that aren't uniform
+    Antialiasing antialiasing;
+    // whether max loops follow the frames of a zoom, with -i as the least they go down to
+    IterationBudget budget;
+    // reuse pixels of the last frame during auto zoom, at most tolerance pixels off
+    bool reuse = false;
+    double tolerance = 0.5;
+    // 0 for one worker per CPU core
+    int threadCount = 0;
+    // kernels of the instruction set, switched over to the fractal once all options are
+    // known, see selectFractal()
+    RowKernels rowKernels;
+    Fractal fractal = FractalMandelbrot;
+    int power = 2;
+    // the c of a Julia set
+    BigComplex julia;
+
+    // the first frame, and where auto zoom goes from there
+    Viewport viewport;
+    BigComplex target;
+    std::vector<Palette> palettes;
+    size_t paletteIndex = 0;
+};
+
+
+// Parse the command line into options. Prints the help text and exits for -h or anything
+// unknown, and exits with an error for kernels, precisions, palettes, fractals or job
+// files that can't be used.
+void parseOptions(int argc, char* argv[], Options* options);
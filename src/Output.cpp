@@ -0,0 +1,349 @@
+#include "Output.hpp"
+#include <png.h>
+#include <immintrin.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+int frameDigits(int maxFrames) {
+    int digits = 4;
+    for (int frames = maxFrames / 10000; frames > 0; frames /= 10) {
+        digits++;
+    }
+    return digits;
+}
+
+
+std::string frameFilename(uint32_t frame, int digits) {
+    std::ostringstream filename;
+    filename << "frames/frame_" << std::setw(digits) << std::setfill('0') << frame << ".png";
+    return filename.str();
+}
+
+
+// libpng hands over the compressed bytes piece by piece.
+static void appendPng(png_structp writer, png_bytep data, png_size_t length) {
+    auto* png = static_cast<std::vector<uint8_t>*>(png_get_io_ptr(writer));
+    png->insert(png->end(), data, data + length);
+}
+
+
+// libpng reports errors by jumping back to the setjmp, so nothing in here may need a
+// destructor to run.
+bool encodePng(const FrameBuffer* frameBuffer, int level, std::vector<uint8_t>* png) {
+    png->clear();
+    png_structp writer = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr,
+                                                 nullptr);
+    if (!writer) {
+        return false;
+    }
+    png_infop info = png_create_info_struct(writer);
+    if (!info || setjmp(png_jmpbuf(writer))) {
+        png_destroy_write_struct(&writer, &info);
+        return false;
+    }
+
+    png_set_write_fn(writer, png, appendPng, nullptr);
+    png_set_compression_level(writer, level);
+    png_set_IHDR(writer, info, frameBuffer->width, frameBuffer->height, 8,
+                 PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+                 PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(writer, info);
+    // the frame buffer is RGBA, but alpha is always 255 and not worth storing
+    png_set_filler(writer, 0, PNG_FILLER_AFTER);
+    const size_t rowBytes = static_cast<size_t>(frameBuffer->width) * 4;
+    for (int y = 0; y < frameBuffer->height; ++y) {
+        png_write_row(writer, frameBuffer->pixels.get() + y * rowBytes);
+    }
+    png_write_end(writer, nullptr);
+    png_destroy_write_struct(&writer, &info);
+    return true;
+}
+
+
+PngRows::PngRows(const std::string& filename, int width, int height, int level) {
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        failed = true;
+        return;
+    }
+    png_structp pngWriter = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr,
+                                                    nullptr, nullptr);
+    png_infop pngInfo = pngWriter ? png_create_info_struct(pngWriter) : nullptr;
+    writer = pngWriter;
+    info = pngInfo;
+    if (!pngInfo || setjmp(png_jmpbuf(pngWriter))) {
+        failed = true;
+        return;
+    }
+    png_init_io(pngWriter, file);
+    png_set_compression_level(pngWriter, level);
+    png_set_IHDR(pngWriter, pngInfo, width, height, 8, PNG_COLOR_TYPE_RGB,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(pngWriter, pngInfo);
+    // the frame buffer is RGBA, but alpha is always 255 and not worth storing
+    png_set_filler(pngWriter, 0, PNG_FILLER_AFTER);
+}
+
+
+PngRows::~PngRows() {
+    png_structp pngWriter = static_cast<png_structp>(writer);
+    png_infop pngInfo = static_cast<png_infop>(info);
+    if (pngWriter) {
+        png_destroy_write_struct(&pngWriter, &pngInfo);
+    }
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+
+bool PngRows::opened() const {
+    return !failed;
+}
+
+
+// Like in encodePng(), a libpng error jumps back to the setjmp.
+bool PngRows::write(const FrameBuffer* frameBuffer, int first, int last) {
+    png_structp pngWriter = static_cast<png_structp>(writer);
+    if (failed || setjmp(png_jmpbuf(pngWriter))) {
+        failed = true;
+        return false;
+    }
+    const size_t rowBytes = static_cast<size_t>(frameBuffer->width) * 4;
+    for (int y = first; y < last; ++y) {
+        png_write_row(pngWriter, frameBuffer->pixels.get() + y * rowBytes);
+    }
+    return true;
+}
+
+
+bool PngRows::finish() {
+    png_structp pngWriter = static_cast<png_structp>(writer);
+    if (failed || setjmp(png_jmpbuf(pngWriter))) {
+        failed = true;
+        return false;
+    }
+    png_write_end(pngWriter, nullptr);
+    const bool closed = std::fclose(file) == 0;
+    file = nullptr;
+    failed = !closed;
+    return closed;
+}
+
+
+bool writeFile(const std::string& filename, const std::vector<uint8_t>& bytes) {
+    FILE* file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return std::fclose(file) == 0 && written;
+}
+
+
+// BT.601 limited range luma of an RGB color, in fixed point with 8 fractional bits.
+static uint8_t lumaOf(int r, int g, int b) {
+    return static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+
+// Convert two rows of RGBA pixels, from column x to the end, into their luma and the
+// chroma of every 2x2 block. The chroma is taken of the average color of the block.
+static void yuvRowsScalar(const uint8_t* top, const uint8_t* bottom, int width, int x,
+                          uint8_t* yTop, uint8_t* yBottom, uint8_t* u, uint8_t* v) {
+    for (; x < width; x += 2) {
+        const int right = std::min(x + 1, width - 1);
+        int r = 0;
+        int g = 0;
+        int b = 0;
+        for (int column : {x, right}) {
+            const uint8_t* upper = top + 4 * column;
+            const uint8_t* lower = bottom + 4 * column;
+            yTop[column] = lumaOf(upper[0], upper[1], upper[2]);
+            yBottom[column] = lumaOf(lower[0], lower[1], lower[2]);
+            r += upper[0] + lower[0];
+            g += upper[1] + lower[1];
+            b += upper[2] + lower[2];
+        }
+        r = (r + 2) >> 2;
+        g = (g + 2) >> 2;
+        b = (b + 2) >> 2;
+        u[x / 2] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v[x / 2] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+}
+
+
+// One channel of 8 RGBA pixels, as 32 bit integers.
+__attribute__((target("avx2")))
+static inline __m256i channelOf(__m256i pixels, int shift) {
+    return _mm256_and_si256(_mm256_srli_epi32(pixels, shift), _mm256_set1_epi32(0xff));
+}
+
+
+// The sums of neighboring pairs of a channel of 16 pixels, in order.
+__attribute__((target("avx2")))
+static inline __m256i pairSums(__m256i left, __m256i right, int shift) {
+    // hadd works within 128 bit lanes, the permute puts the sums back in order
+    return _mm256_permute4x64_epi64(_mm256_hadd_epi32(channelOf(left, shift),
+                                                      channelOf(right, shift)), 0xd8);
+}
+
+
+// The weighted sum of the channels of 8 colors, rounded for a shift by 8 bits.
+__attribute__((target("avx2")))
+static inline __m256i weightedAvx2(__m256i r, __m256i g, __m256i b, int weightR, int weightG,
+                                   int weightB) {
+    return _mm256_add_epi32(
+        _mm256_add_epi32(_mm256_mullo_epi32(r, _mm256_set1_epi32(weightR)),
+                         _mm256_mullo_epi32(g, _mm256_set1_epi32(weightG))),
+        _mm256_add_epi32(_mm256_mullo_epi32(b, _mm256_set1_epi32(weightB)),
+                         _mm256_set1_epi32(128)));
+}
+
+
+// The luma of 16 RGBA pixels as bytes.
+__attribute__((target("avx2")))
+static inline __m128i lumaAvx2(__m256i left, __m256i right) {
+    __m256i luma[2];
+    const __m256i pixels[2] = {left, right};
+    for (int i = 0; i < 2; ++i) {
+        __m256i sum = weightedAvx2(channelOf(pixels[i], 0), channelOf(pixels[i], 8),
+                                   channelOf(pixels[i], 16), 66, 129, 25);
+        luma[i] = _mm256_add_epi32(_mm256_srli_epi32(sum, 8), _mm256_set1_epi32(16));
+    }
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(luma[0], luma[1]), 0xd8);
+    return _mm_packus_epi16(_mm256_castsi256_si128(words),
+                            _mm256_extracti128_si256(words, 1));
+}
+
+
+// A chroma channel of 8 averaged colors, before it is packed into bytes.
+__attribute__((target("avx2")))
+static inline __m256i chromaAvx2(__m256i r, __m256i g, __m256i b, int weightR, int weightG,
+                                 int weightB) {
+    __m256i sum = weightedAvx2(r, g, b, weightR, weightG, weightB);
+    return _mm256_add_epi32(_mm256_srai_epi32(sum, 8), _mm256_set1_epi32(128));
+}
+
+
+// Same as yuvRowsScalar, 16 columns at once. Gives exactly the same bytes, the remaining
+// columns are left to yuvRowsScalar.
+__attribute__((target("avx2")))
+static void yuvRowsAvx2(const uint8_t* top, const uint8_t* bottom, int width, int x,
+                        uint8_t* yTop, uint8_t* yBottom, uint8_t* u, uint8_t* v) {
+    const __m256i two = _mm256_set1_epi32(2);
+    for (; x + 16 <= width; x += 16) {
+        const __m256i topLeft = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(top + 4 * x));
+        const __m256i topRight = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(top + 4 * x + 32));
+        const __m256i bottomLeft = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(bottom + 4 * x));
+        const __m256i bottomRight = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(bottom + 4 * x + 32));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(yTop + x), lumaAvx2(topLeft, topRight));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(yBottom + x),
+                         lumaAvx2(bottomLeft, bottomRight));
+
+        __m256i average[3];
+        for (int channel = 0; channel < 3; ++channel) {
+            __m256i sum = _mm256_add_epi32(pairSums(topLeft, topRight, 8 * channel),
+                                           pairSums(bottomLeft, bottomRight, 8 * channel));
+            average[channel] = _mm256_srli_epi32(_mm256_add_epi32(sum, two), 2);
+        }
+        __m256i chromaU = chromaAvx2(average[0], average[1], average[2], -38, -74, 112);
+        __m256i chromaV = chromaAvx2(average[0], average[1], average[2], 112, -94, -18);
+        // 8 u followed by 8 v
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(chromaU, chromaV), 0xd8);
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words),
+                                         _mm256_extracti128_si256(words, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x / 2), bytes);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(v + x / 2), _mm_srli_si128(bytes, 8));
+    }
+    yuvRowsScalar(top, bottom, width, x, yTop, yBottom, u, v);
+}
+
+
+using YuvRows = void (*)(const uint8_t* top, const uint8_t* bottom, int width, int x,
+                         uint8_t* yTop, uint8_t* yBottom, uint8_t* u, uint8_t* v);
+
+
+static YuvRows detectYuvRows() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? yuvRowsAvx2 : yuvRowsScalar;
+}
+
+
+void encodeY4m(const FrameBuffer* frameBuffer, bool streamHeader, std::vector<uint8_t>* y4m) {
+    static const YuvRows yuvRows = detectYuvRows();
+    const int width = frameBuffer->width;
+    const int height = frameBuffer->height;
+    const int chromaWidth = (width + 1) / 2;
+    const int chromaHeight = (height + 1) / 2;
+
+    std::ostringstream header;
+    if (streamHeader) {
+        header << "YUV4MPEG2 W" << width << " H" << height << " F30:1 Ip A1:1 C420jpeg\n";
+    }
+    header << "FRAME\n";
+    const std::string headerBytes = header.str();
+    const size_t lumaSize = static_cast<size_t>(width) * height;
+    const size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+    y4m->resize(headerBytes.size() + lumaSize + 2 * chromaSize);
+    std::memcpy(y4m->data(), headerBytes.data(), headerBytes.size());
+
+    uint8_t* luma = y4m->data() + headerBytes.size();
+    uint8_t* chromaU = luma + lumaSize;
+    uint8_t* chromaV = chromaU + chromaSize;
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+    for (int y = 0; y < height; y += 2) {
+        // the last row of an odd height is its own block partner
+        const int below = std::min(y + 1, height - 1);
+        yuvRows(frameBuffer->pixels.get() + y * rowBytes,
+                frameBuffer->pixels.get() + below * rowBytes, width, 0,
+                luma + static_cast<size_t>(y) * width,
+                luma + static_cast<size_t>(below) * width,
+                chromaU + static_cast<size_t>(y / 2) * chromaWidth,
+                chromaV + static_cast<size_t>(y / 2) * chromaWidth);
+    }
+}
+
+
+void encodeRgb(const FrameBuffer* frameBuffer, std::vector<uint8_t>* rgb) {
+    const size_t pixels = static_cast<size_t>(frameBuffer->width) * frameBuffer->height;
+    rgb->resize(pixels * 3);
+    const uint8_t* from = frameBuffer->pixels.get();
+    uint8_t* to = rgb->data();
+    for (size_t i = 0; i < pixels; ++i) {
+        to[3 * i] = from[4 * i];
+        to[3 * i + 1] = from[4 * i + 1];
+        to[3 * i + 2] = from[4 * i + 2];
+    }
+}
+
+
+FILE* openStream(const std::string& path) {
+    if (path == "-") {
+        std::cout.rdbuf(std::cerr.rdbuf());
+        return stdout;
+    }
+    // opening a named pipe waits until somebody opens it for reading
+    FILE* stream = std::fopen(path.c_str(), "wb");
+    if (!stream) {
+        std::cout << "Could not open " << path << " to stream frames into.\n";
+        exit(1);
+    }
+    return stream;
+}
+
+
+bool writeStream(FILE* stream, const std::vector<uint8_t>& bytes) {
+    bool written = std::fwrite(bytes.data(), 1, bytes.size(), stream) == bytes.size();
+    return std::fflush(stream) == 0 && written;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "FrameBuffer.hpp"
+
+
+// What saved frames are encoded as. Png frames go into a file each, the others are
+// streamed one after the other into a single file or pipe.
+enum FrameFormat {
+    // compressed with libpng
+    FramePng,
+    // YUV4MPEG2 with 4:2:0 chroma, BT.601 limited range, 30 frames per second
+    FrameY4m,
+    // raw 8 bit RGB without any header, as for ffmpeg's rawvideo rgb24
+    FrameRgb
+};
+
+
+// How many digits frame numbers get so that they all sort in order: at least 4, more if
+// maxFrames needs them.
+int frameDigits(int maxFrames);
+
+
+// Where frame number frame is saved: frames/frame_0001.png and so on, with frame numbers
+// padded to digits.
+std::string frameFilename(uint32_t frame, int digits);
+
+
+// Compress the frame buffer into png at the given zlib level, 0 (fastest, no compression)
+// to 9 (smallest). Returns false if libpng fails.
+bool encodePng(const FrameBuffer* frameBuffer, int level, std::vector<uint8_t>* png);
+
+
+// Write the bytes into the file, replacing it. Returns false if it can't be written.
+bool writeFile(const std::string& filename, const std::vector<uint8_t>& bytes);
+
+
+// A png file that is written a few rows at a time, so images far too big for memory can
+// be saved while they are rendered. Every method returns false once libpng or the file
+// failed, and the file is then incomplete.
+class PngRows {
+public:
+    // Create the file for a width x height image compressed at the zlib level, 0 to 9.
+    PngRows(const std::string& filename, int width, int height, int level);
+    // Closes the file, finished or not.
+    ~PngRows();
+
+    PngRows(const PngRows&) = delete;
+    PngRows& operator=(const PngRows&) = delete;
+
+    // Whether the file could be created and its header written.
+    bool opened() const;
+
+    // Append the rows first up to last exclusive of the frame buffer, which is as wide as
+    // the image, below the rows written so far.
+    bool write(const FrameBuffer* frameBuffer, int first, int last);
+
+    // Write the end of the file once all rows are in and close it.
+    bool finish();
+
+private:
+    FILE* file = nullptr;
+    void* writer = nullptr;
+    void* info = nullptr;
+    bool failed = false;
+};
+
+
+// Convert the frame buffer into one YUV4MPEG2 frame, with the stream header in front if
+// it is the first frame of the stream. Odd widths and heights are fine, the chroma of the
+// last column or row is then averaged over just that column or row.
+void encodeY4m(const FrameBuffer* frameBuffer, bool streamHeader, std::vector<uint8_t>* y4m);
+
+
+// Strip the alpha byte off every pixel of the frame buffer.
+void encodeRgb(const FrameBuffer* frameBuffer, std::vector<uint8_t>* rgb);
+
+
+// Open the file or named pipe frames are streamed into, "-" for stdout. Streaming to
+// stdout sends all text output to stderr instead, so it doesn't end up in the stream.
+// Exits with an error if the file can't be opened.
+FILE* openStream(const std::string& path);
+
+
+// Append the bytes to the stream and flush them, so whoever reads the stream gets every
+// frame as soon as it is done. Returns false if they can't be written.
+bool writeStream(FILE* stream, const std::vector<uint8_t>& bytes);
@@ -0,0 +1,176 @@
+#include "Palette.hpp"
+#include <math.h>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <immintrin.h>
+
+
+// Pack a color into the RGBA bytes of a frame buffer pixel.
+static uint32_t packColor(uint8_t r, uint8_t g, uint8_t b) {
+    const uint8_t bytes[4] = {r, g, b, 255};
+    uint32_t packed;
+    std::memcpy(&packed, bytes, sizeof(packed));
+    return packed;
+}
+
+
+// Converts HSV values to a packed color in RGB space
+static uint32_t hsvToRgb(float h, float s, float v) {
+    float c = v * s; // Chroma
+    float x = c * (1 - std::fabs(std::fmod(h / 60.0f, 2) - 1));
+    float m = v - c;
+
+    float r, g, b;
+    if (h < 60) {r = c; g = x; b = 0; }
+    else if (h < 120){ r = x; g = c; b = 0; }
+    else if (h < 180){ r = 0; g = c; b = x; }
+    else if (h < 240){ r = 0; g = x; b = c; }
+    else if (h < 300){ r = x; g = 0; b = c; }
+    else             { r = c; g = 0; b = x; }
+
+    return packColor(static_cast<uint8_t>((r + m) * 255),
+                     static_cast<uint8_t>((g + m) * 255),
+                     static_cast<uint8_t>((b + m) * 255));
+}
+
+
+// Color of the built-in palette for a pixel that exploded after i loops.
+static uint32_t builtinColor(int i) {
+    // Normalized progress (0 to 1)
+    float t = static_cast<float>(i) / 500;
+
+    // Apply nonlinear transformation to compress high values
+    t = std::pow(t, 0.9f); // (0.5 = strong stretch, 1.0 = linear)
+
+    // Repeat hue multiple times
+    float hue = fmod(360.0f * t * 1.2f, 360.0f);
+
+    float saturation = 0.8f;
+    float value = 0.9f;
+
+    return hsvToRgb(hue, saturation, value);
+}
+
+
+// Color of a loaded palette for a pixel that exploded after i loops, blended between the
+// two colors it lies in between.
+static uint32_t gradientColor(const Palette* palette, int i) {
+    const int count = static_cast<int>(palette->colors.size());
+    double position = static_cast<double>(i % palette->period) / palette->period * count;
+    int index = static_cast<int>(position);
+    double blend = position - index;
+    uint8_t from[4];
+    uint8_t to[4];
+    std::memcpy(from, &palette->colors[index], sizeof(from));
+    std::memcpy(to, &palette->colors[(index + 1) % count], sizeof(to));
+
+    uint8_t mixed[3];
+    for (int channel = 0; channel < 3; ++channel) {
+        mixed[channel] = static_cast<uint8_t>(lround(from[channel] * (1 - blend)
+                                                     + to[channel] * blend));
+    }
+    return packColor(mixed[0], mixed[1], mixed[2]);
+}
+
+
+Palette builtinPalette() {
+    Palette palette;
+    palette.name = "builtin";
+    return palette;
+}
+
+
+bool loadPalette(const char* path, Palette* palette) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    Palette loaded;
+    loaded.name = path;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream words(line);
+        std::string first;
+        if (!(words >> first) || first[0] == '#') {
+            continue;
+        }
+        if (first == "period") {
+            if (!(words >> loaded.period) || loaded.period < 1) {
+                return false;
+            }
+            continue;
+        }
+        int r, g, b;
+        std::istringstream color(line);
+        if (!(color >> r >> g >> b) || r < 0 || r > 255 || g < 0 || g > 255 || b < 0
+            || b > 255) {
+            return false;
+        }
+        loaded.colors.push_back(packColor(r, g, b));
+    }
+    if (loaded.colors.empty()) {
+        return false;
+    }
+    (*palette) = std::move(loaded);
+    return true;
+}
+
+
+void updateColorTable(ColorTable* table, const Palette* palette, int maxI) {
+    if (table->palette == palette && table->maxI == maxI) {
+        return;
+    }
+    table->palette = palette;
+    table->maxI = maxI;
+    table->colors.resize(maxI + 1);
+    for (int i = 0; i < maxI; ++i) {
+        table->colors[i] = palette->colors.empty() ? builtinColor(i)
+                                                   : gradientColor(palette, i);
+    }
+    // Inside the set
+    table->colors[maxI] = packColor(0, 0, 0);
+}
+
+
+// Look up one pixel after the other.
+static void colorizeScalar(const uint32_t* colors, int maxI, const int* loops, int count,
+                           uint8_t* pixels) {
+    for (int x = 0; x < count; ++x, pixels += 4) {
+        std::memcpy(pixels, &colors[loops[x] < maxI ? loops[x] : maxI], 4);
+    }
+}
+
+
+// Look up 8 pixels at once with a single gather, which fits because a packed color is
+// exactly as wide as an amount of loops.
+__attribute__((target("avx2")))
+static void colorizeAvx2(const uint32_t* colors, int maxI, const int* loops, int count,
+                         uint8_t* pixels) {
+    const __m256i maxVector = _mm256_set1_epi32(maxI);
+    const int* table = reinterpret_cast<const int*>(colors);
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(loops + x));
+        index = _mm256_min_epi32(index, maxVector);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + 4 * x),
+                            _mm256_i32gather_epi32(table, index, 4));
+    }
+    colorizeScalar(colors, maxI, loops + x, count - x, pixels + 4 * x);
+}
+
+
+using ColorizeRow = void (*)(const uint32_t* colors, int maxI, const int* loops, int count,
+                             uint8_t* pixels);
+
+
+static ColorizeRow detectColorizeRow() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? colorizeAvx2 : colorizeScalar;
+}
+
+
+void colorize(const ColorTable* table, const int* loops, int count, uint8_t* pixels) {
+    static const ColorizeRow colorizeRow = detectColorizeRow();
+    colorizeRow(table->colors.data(), table->maxI, loops, count, pixels);
+}
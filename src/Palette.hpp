@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// How amounts of loops are turned into colors. Without any colors it is the built-in
+// palette that goes round the hue circle. Otherwise the colors are spread evenly over
+// period loops and blended linearly, from the last color back to the first, so the
+// palette repeats every period loops.
+struct Palette {
+    std::string name;
+    // packed as the RGBA bytes of a frame buffer pixel
+    std::vector<uint32_t> colors;
+    int period = 500;
+};
+
+
+// The color of every amount of loops from 0 to max loops for one palette, so coloring a
+// pixel is a single lookup. It is only built again when the palette or max loops change.
+struct ColorTable {
+    const Palette* palette = nullptr;
+    int maxI = -1;
+    // maxI + 1 colors, the last one is black for the pixels inside the set
+    std::vector<uint32_t> colors;
+};
+
+
+// The palette used unless another one is loaded.
+Palette builtinPalette();
+
+
+// Load a palette from a text file with one color per line, given as "R G B" from 0 to
+// 255. A line "period LOOPS" sets how many loops it takes to go through all colors once.
+// Empty lines and lines starting with # are skipped. Returns false if the file can't be
+// read, has a line that is neither, or has no colors.
+bool loadPalette(const char* path, Palette* palette);
+
+
+// Build the table for the palette and max loops, unless it already is.
+void updateColorTable(ColorTable* table, const Palette* palette, int maxI);
+
+
+// Write the colors of count pixels with the given amounts of loops into their RGBA bytes.
+// Amounts above the max loops of the table are inside the set like max loops itself.
+// Runs 8 pixels at once with AVX2 gathers if the CPU supports it.
+void colorize(const ColorTable* table, const int* loops, int count, uint8_t* pixels);
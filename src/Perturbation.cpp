@@ -0,0 +1,224 @@
+#include "Perturbation.hpp"
+#include <math.h>
+
+
+// While S is below 2^-900 the deltas are far too small for doubles and are iterated in
+// multiples of S. |delta| is then at most 2^-644, so delta^2 is way below double
+// rounding compared to delta and can be dropped.
+static const long scaledLimitExp = -900;
+
+// Deltas in multiples of S are scaled back down by 2^256 whenever they get this big.
+static const int rescaleExp = 256;
+
+// |Z_n| below 2^-600 is small enough that a pixel might have to rebase on it while its
+// delta is still stored in multiples of S.
+static const double tinyReference = ldexp(1.0, -600);
+
+// Series approximation is used as long as its third order term is below 2^-32 of the
+// first order term, so the terms it drops are far below double rounding.
+static const double seriesTolerance = ldexp(1.0, -32);
+
+
+// Run the "mandelbrot sequence" on the viewport center in full precision and store every
+// step as doubles, until it explodes or max loops is reached.
+static void computeReferenceOrbit(const Viewport *viewport, int maxI, DeepFrame *frame) {
+    mp_bitcnt_t precision = viewport->center.real.get_prec();
+    mpf_class zr(0, precision), zi(0, precision);
+    mpf_class zr2(0, precision), zi2(0, precision), temp(0, precision);
+    mpf_class cr(viewport->center.real, precision), ci(viewport->center.imag, precision);
+
+    frame->refReal.clear();
+    frame->refImag.clear();
+    frame->refTiny.clear();
+    for (int n = 0; n <= maxI; ++n) {
+        double real = zr.get_d();
+        double imag = zi.get_d();
+        frame->refReal.push_back(real);
+        frame->refImag.push_back(imag);
+        frame->refTiny.push_back(fabs(real) + fabs(imag) < tinyReference);
+        if (real * real + imag * imag >= 4) {
+            break;
+        }
+        mpf_mul(zr2.get_mpf_t(), zr.get_mpf_t(), zr.get_mpf_t());
+        mpf_mul(zi2.get_mpf_t(), zi.get_mpf_t(), zi.get_mpf_t());
+        // imag = 2 * real * imag + ci
+        mpf_mul(temp.get_mpf_t(), zr.get_mpf_t(), zi.get_mpf_t());
+        mpf_mul_2exp(temp.get_mpf_t(), temp.get_mpf_t(), 1);
+        mpf_add(zi.get_mpf_t(), temp.get_mpf_t(), ci.get_mpf_t());
+        // real = real^2 - imag^2 + cr
+        mpf_sub(temp.get_mpf_t(), zr2.get_mpf_t(), zi2.get_mpf_t());
+        mpf_add(zr.get_mpf_t(), temp.get_mpf_t(), cr.get_mpf_t());
+    }
+}
+
+
+// Find how many iterations can be skipped for all pixels at once. With dc being the
+// pixel offset and delta_n its offset to Z_n, both in multiples of S, delta_n is
+// approximated by a_n*dc + b_n*dc^2 + c_n*dc^3 where
+//     a_n+1 = 2*Z_n*a_n + 1
+//     b_n+1 = 2*Z_n*b_n + S*a_n^2
+//     c_n+1 = 2*Z_n*c_n + 2*S*a_n*b_n
+// The approximation is only used while it is accurate for the pixel furthest from the
+// center and no pixel could have exploded or needed to rebase on the way.
+static void computeSeriesApproximation(int maxI, DeepFrame *frame) {
+    const long scale = frame->scaleExp;
+    const double dMax = 0.5 * sqrt(frame->spanReal * frame->spanReal
+                                   + frame->spanImag * frame->spanImag);
+    const int refLast = static_cast<int>(frame->refReal.size()) - 1;
+    double ar = 0, ai = 0, br = 0, bi = 0, cr = 0, ci = 0;
+
+    for (int n = 0; n < refLast && n < maxI; ++n) {
+        double zr = frame->refReal[n];
+        double zi = frame->refImag[n];
+        // a^2 and 2*a*b, still to be multiplied by S
+        double a2r = ar * ar - ai * ai;
+        double a2i = 2 * ar * ai;
+        double abr = 2 * (ar * br - ai * bi);
+        double abi = 2 * (ar * bi + ai * br);
+        double nar = 2 * (zr * ar - zi * ai) + 1;
+        double nai = 2 * (zr * ai + zi * ar);
+        double nbr = 2 * (zr * br - zi * bi) + ldexp(a2r, scale);
+        double nbi = 2 * (zr * bi + zi * br) + ldexp(a2i, scale);
+        double ncr = 2 * (zr * cr - zi * ci) + ldexp(abr, scale);
+        double nci = 2 * (zr * ci + zi * cr) + ldexp(abi, scale);
+
+        double first = hypot(nar, nai) * dMax;
+        double second = hypot(nbr, nbi) * dMax * dMax;
+        double third = hypot(ncr, nci) * dMax * dMax * dMax;
+        if (!(third <= seriesTolerance * first) || first > ldexp(1.0, rescaleExp)) {
+            break;
+        }
+        // largest delta any pixel can have, in absolute terms
+        double deltaMax = ldexp(first + second + third, scale);
+        double next = hypot(frame->refReal[n + 1], frame->refImag[n + 1]);
+        if (next + deltaMax >= 2 || next <= 2 * deltaMax) {
+            break;
+        }
+
+        ar = nar; ai = nai; br = nbr; bi = nbi; cr = ncr; ci = nci;
+        frame->skip = n + 1;
+    }
+    frame->aReal = ar; frame->aImag = ai;
+    frame->bReal = br; frame->bImag = bi;
+    frame->cReal = cr; frame->cImag = ci;
+}
+
+
+// Compute the reference orbit and, if enabled, the series approximation for the frame.
+void prepareDeepFrame(const Viewport *viewport, int width, int maxI,
+                      bool seriesApproximation, DeepFrame *frame) {
+    computeReferenceOrbit(viewport, maxI, frame);
+
+    // S is the power of two at the pixel spacing, so pixel offsets are in the order of
+    // the resolution
+    frame->scaleExp = pixelSpacingExp(viewport, width);
+    long exponent;
+    double mantissa = mpf_get_d_2exp(&exponent, viewport->spanReal.get_mpf_t());
+    frame->spanReal = ldexp(mantissa, exponent - frame->scaleExp);
+    mantissa = mpf_get_d_2exp(&exponent, viewport->spanImag.get_mpf_t());
+    frame->spanImag = ldexp(mantissa, exponent - frame->scaleExp);
+
+    frame->skip = 0;
+    frame->aReal = frame->aImag = 0;
+    frame->bReal = frame->bImag = 0;
+    frame->cReal = frame->cImag = 0;
+    if (seriesApproximation) {
+        computeSeriesApproximation(maxI, frame);
+    }
+}
+
+
+// Amount of loops for the pixel (x, y). The pixel's own sequence is z_n = Z_n + delta_n
+// with delta_n+1 = 2*Z_n*delta_n + delta_n^2 + dc. Whenever |z_n| gets smaller than
+// |delta_n| or the reference orbit ends, the pixel rebases: delta becomes z_n and the
+// reference starts over at Z_0 = 0. That way glitches can't occur with a single
+// reference orbit.
+int perturbedLoops(const DeepFrame &frame, double x, double y, int width, int height,
+                   int maxI) {
+    const double *refReal = frame.refReal.data();
+    const double *refImag = frame.refImag.data();
+    const int refLast = static_cast<int>(frame.refReal.size()) - 1;
+    long scale = frame.scaleExp;
+
+    double dcr = (x / width - 0.5) * frame.spanReal;
+    double dci = (y / height - 0.5) * frame.spanImag;
+    double dr = 0;
+    double di = 0;
+    int n = 0;
+    int m = 0;
+
+    if (frame.skip > 0) {
+        double dc2r = dcr * dcr - dci * dci;
+        double dc2i = 2 * dcr * dci;
+        double dc3r = dc2r * dcr - dc2i * dci;
+        double dc3i = dc2r * dci + dc2i * dcr;
+        dr = frame.aReal * dcr - frame.aImag * dci + frame.bReal * dc2r
+             - frame.bImag * dc2i + frame.cReal * dc3r - frame.cImag * dc3i;
+        di = frame.aReal * dci + frame.aImag * dcr + frame.bReal * dc2i
+             + frame.bImag * dc2r + frame.cReal * dc3i + frame.cImag * dc3r;
+        n = frame.skip;
+        m = frame.skip;
+    }
+
+    // delta in multiples of S, linear since delta^2 is negligible
+    while (scale < scaledLimitExp && n < maxI) {
+        double zr = refReal[m];
+        double zi = refImag[m];
+        // |delta| is far below double precision of z, so z explodes exactly when Z does
+        if (zr * zr + zi * zi >= 4) {
+            return n;
+        }
+        if (frame.refTiny[m]) {
+            double sr = ldexp(zr, -scale) + dr;
+            double si = ldexp(zi, -scale) + di;
+            if (sr * sr + si * si < dr * dr + di * di) {
+                dr = sr;
+                di = si;
+                m = 0;
+                zr = 0;
+                zi = 0;
+            }
+        }
+        double newReal = 2 * (zr * dr - zi * di) + dcr;
+        di = 2 * (zr * di + zi * dr) + dci;
+        dr = newReal;
+        n++;
+        m++;
+        if (fabs(dr) + fabs(di) > ldexp(1.0, rescaleExp)) {
+            dr = ldexp(dr, -rescaleExp);
+            di = ldexp(di, -rescaleExp);
+            dcr = ldexp(dcr, -rescaleExp);
+            dci = ldexp(dci, -rescaleExp);
+            scale += rescaleExp;
+        }
+    }
+
+    // delta is big enough for plain doubles now
+    dr = ldexp(dr, scale);
+    di = ldexp(di, scale);
+    dcr = ldexp(dcr, scale);
+    dci = ldexp(dci, scale);
+    while (n < maxI) {
+        double zr = refReal[m];
+        double zi = refImag[m];
+        double pixelReal = zr + dr;
+        double pixelImag = zi + di;
+        double pixelAbs = pixelReal * pixelReal + pixelImag * pixelImag;
+        if (pixelAbs >= 4) {
+            return n;
+        }
+        if (pixelAbs < dr * dr + di * di || m == refLast) {
+            dr = pixelReal;
+            di = pixelImag;
+            m = 0;
+            zr = 0;
+            zi = 0;
+        }
+        double newReal = 2 * (zr * dr - zi * di) + (dr * dr - di * di) + dcr;
+        di = 2 * (zr * di + zi * dr) + 2 * dr * di + dci;
+        dr = newReal;
+        n++;
+        m++;
+    }
+    return n;
+}
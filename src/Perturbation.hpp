@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include "Viewport.hpp"
+
+
+// Everything the workers need to iterate the pixels of one deep zoom frame. The
+// reference orbit Z_n of the viewport center is computed once in high precision and
+// every pixel only iterates its small difference (delta) to it in doubles.
+//
+// Deltas are stored as multiples of S = 2^scaleExp, roughly the pixel spacing, so they
+// stay representable far below the smallest double.
+struct DeepFrame {
+    std::vector<double> refReal;
+    std::vector<double> refImag;
+    // true where |Z_n| is so small that a pixel could have to rebase on it
+    std::vector<char> refTiny;
+    long scaleExp;
+    // viewport span divided by S
+    double spanReal;
+    double spanImag;
+    // iterations skipped by series approximation and the coefficients of
+    // delta = a*dc + b*dc^2 + c*dc^3 at that point, all divided by S accordingly
+    int skip;
+    double aReal, aImag;
+    double bReal, bImag;
+    double cReal, cImag;
+};
+
+
+// Compute the reference orbit and, if enabled, the series approximation for the frame.
+void prepareDeepFrame(const Viewport *viewport, int width, int maxI,
+                      bool seriesApproximation, DeepFrame *frame);
+
+
+// Amount of loops for the (possibly fractional) pixel position (x, y) of the frame,
+// equivalent to mandelbrot() on its exact complex value.
+int perturbedLoops(const DeepFrame &frame, double x, double y, int width, int height,
+                   int maxI);
@@ -0,0 +1,131 @@
+#include "Poster.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Render.hpp"
+#include "Output.hpp"
+#include "Trace.hpp"
+
+
+// Seconds since start.
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// The part of the viewport with the rows first up to last exclusive of an image height
+// rows high. Its rows are where the rows of the whole image are, up to rounding of the
+// anchors, so the strips fit together without seams.
+static void stripViewport(const Viewport* viewport, int height, int first, int last,
+                          Viewport* strip) {
+    const mp_bitcnt_t precision = viewport->center.real.get_prec();
+    strip->center.real.set_prec(precision);
+    strip->center.imag.set_prec(precision);
+    strip->spanReal.set_prec(precision);
+    strip->spanImag.set_prec(precision);
+    strip->center.real = viewport->center.real;
+    strip->center.imag = viewport->center.imag
+                         + viewport->spanImag * (first + last - height) / (2 * height);
+    strip->spanReal = viewport->spanReal;
+    strip->spanImag = viewport->spanImag * (last - first) / height;
+}
+
+
+int runPoster(const Options* options) {
+    const int width = options->width;
+    const int height = options->height;
+    if (width < 1 || height < 1) {
+        std::cout << "A poster needs a resolution of at least 1x1.\n";
+        return 1;
+    }
+    PngRows png(options->posterPath, width, height, options->pngLevel);
+    if (!png.opened()) {
+        std::cout << "Poster " << options->posterPath << " could not be created.\n";
+        return 1;
+    }
+
+    std::unique_ptr<Trace> trace;
+    if (!options->tracePath.empty()) {
+        trace.reset(new Trace(options->tracePath));
+    }
+    ThreadPool pool(options->threadCount);
+    pool.setTrace(trace.get());
+    // every strip gets the precision of the whole image, so they all look alike
+    const Precision precision = options->autoPrecision
+                                ? choosePrecision(&options->viewport, width,
+                                                  hasPerturbation(&options->rowKernels))
+                                : options->precision;
+    ColorTable colorTable;
+    updateColorTable(&colorTable, &options->palettes[options->paletteIndex], options->maxI);
+    std::vector<int> iterations;
+    LastFrame lastFrame;
+    FrameStats stats;
+    // one strip is written while the other one renders
+    FrameBuffer strips[2];
+    std::thread writer;
+    bool written = true;
+
+    double computeMs = 0;
+    long antialiasedPixels = 0;
+    auto start = std::chrono::steady_clock::now();
+    const int stripCount = (height + posterStripRows - 1) / posterStripRows;
+    for (int index = 0; index < stripCount; ++index) {
+        // a row more on either side, so anti-aliasing sees the neighbours of the edge rows
+        const int first = index * posterStripRows;
+        const int last = std::min(height, first + posterStripRows);
+        const int renderFirst = std::max(0, first - 1);
+        const int renderLast = std::min(height, last + 1);
+        const int rows = renderLast - renderFirst;
+        Viewport viewport;
+        stripViewport(&options->viewport, height, renderFirst, renderLast, &viewport);
+
+        FrameBuffer* strip = &strips[index % 2];
+        if (strip->width != width || strip->height != rows) {
+            allocFrameBuffer(strip, width, rows);
+        }
+        divideAndConquer(&pool, &viewport, width, rows, options->maxI,
+                         options->interiorChecks, &options->rowKernels, precision,
+                         options->seriesApproximation, options->subdivision, nullptr,
+                         &iterations, &lastFrame, &colorTable, strip, &stats);
+        antialiasFrame(&pool, &viewport, width, rows, options->maxI,
+                       options->interiorChecks, &options->rowKernels, precision,
+                       options->seriesApproximation, &options->antialiasing, iterations,
+                       &colorTable, strip, &stats, nullptr);
+        computeMs += stats.computeMs + stats.antialiasMs;
+        antialiasedPixels += stats.antialiasedPixels;
+
+        if (writer.joinable()) {
+            writer.join();
+        }
+        if (!written) {
+            break;
+        }
+        writer = std::thread([&png, &written, strip, first, last, renderFirst]() {
+            written = png.write(strip, first - renderFirst, last - renderFirst);
+        });
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+    if (!written || !png.finish()) {
+        std::cout << "Poster " << options->posterPath << " could not be written.\n";
+        return 1;
+    }
+    double totalSeconds = secondsSince(start);
+
+    const double pixels = static_cast<double>(width) * height;
+    std::cout << std::fixed << std::setprecision(3)
+              << "Rendered " << width << "x" << height << " in " << stripCount
+              << " strips in " << totalSeconds << " s: " << pixels / totalSeconds / 1e6
+              << " Mpixels/s, of which compute " << computeMs / 1000 << " s\n";
+    if (options->antialiasing.maxSamples > 1) {
+        std::cout << std::setprecision(1) << "Anti-aliasing: "
+                  << 100 * antialiasedPixels / pixels << "% of the pixels refined\n";
+    }
+    std::cout << "Saved to " << options->posterPath << "\n";
+    return 0;
+}
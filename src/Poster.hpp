@@ -0,0 +1,14 @@
+#pragma once
+#include "Options.hpp"
+
+
+// Rows of the image rendered at once for a poster.
+const int posterStripRows = 256;
+
+
+// Render the start view at the -r resolution into a single png file without a window, as
+// horizontal strips of posterStripRows rows. Every strip is rendered on the pool like a
+// frame of its own and written to the file while the next one renders, so no more than
+// two strips are in memory at once, however big the image is. The iteration, precision,
+// rendering and anti-aliasing options still apply. Returns the exit code.
+int runPoster(const Options* options);
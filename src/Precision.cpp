@@ -0,0 +1,66 @@
+#include "Precision.hpp"
+#include <math.h>
+#include <cstring>
+#include <algorithm>
+
+
+// Bits every number type has to have left over below the pixel spacing. Rounding errors
+// grow with every iteration, so a pixel needs some room before it starts to look blocky.
+static const int guardBits = 10;
+
+
+static const char* precisionNames[] = {
+    NumberTraits<float>::name,
+    NumberTraits<double>::name,
+    NumberTraits<DoubleDouble>::name,
+    NumberTraits<QuadDouble>::name,
+    "perturbation"
+};
+
+
+// Display name of a precision, also used to pick one on the command line.
+const char* precisionName(Precision precision) {
+    return precisionNames[precision];
+}
+
+
+// Look up a precision by name. Returns false if the name is unknown.
+bool findPrecision(const char* name, Precision* precision) {
+    for (int i = PrecisionFloat; i <= PrecisionPerturbation; ++i) {
+        if (std::strcmp(name, precisionNames[i]) == 0) {
+            (*precision) = static_cast<Precision>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Pick the fastest precision that can still tell neighbouring pixels of the viewport
+// apart. A number type with epsilon 2^-mantissaBits resolves steps of
+// |c| * 2^-mantissaBits, so it needs log2(|c|) - log2(spacing) bits plus the guard bits.
+// Past double-double, perturbation iterates in doubles and beats the scalar quad-double
+// kernel by far, so quad-double is only picked for fractals without perturbation.
+Precision choosePrecision(const Viewport *viewport, int width, bool perturbation) {
+    double maxReal = fabs(viewport->center.real.get_d())
+                     + fabs(viewport->spanReal.get_d()) / 2;
+    double maxImag = fabs(viewport->center.imag.get_d())
+                     + fabs(viewport->spanImag.get_d()) / 2;
+    int magnitudeExp;
+    frexp(std::max(maxReal, maxImag), &magnitudeExp);
+    long neededBits = magnitudeExp - pixelSpacingExp(viewport, width) + guardBits;
+
+    if (neededBits <= NumberTraits<float>::mantissaBits) {
+        return PrecisionFloat;
+    }
+    if (neededBits <= NumberTraits<double>::mantissaBits) {
+        return PrecisionDouble;
+    }
+    if (neededBits <= NumberTraits<DoubleDouble>::mantissaBits) {
+        return PrecisionDoubleDouble;
+    }
+    if (perturbation) {
+        return PrecisionPerturbation;
+    }
+    return PrecisionQuadDouble;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "Viewport.hpp"
+
+
+// Number types a frame can be rendered with, from fastest to most precise. Past
+// double-double precision frames are rendered with perturbation.
+enum Precision {
+    PrecisionFloat,
+    PrecisionDouble,
+    PrecisionDoubleDouble,
+    PrecisionQuadDouble,
+    PrecisionPerturbation
+};
+
+
+// Display name of a precision, also used to pick one on the command line.
+const char* precisionName(Precision precision);
+
+
+// Look up a precision by name. Returns false if the name is unknown.
+bool findPrecision(const char* name, Precision* precision);
+
+
+// Pick the fastest precision that can still tell neighbouring pixels of the viewport
+// apart, by comparing the pixel spacing to the epsilon of each number type. Past
+// double-double it is perturbation, or quad-double without it, which only the Mandelbrot
+// set has. Quad-double is otherwise only used when forced with -q.
+Precision choosePrecision(const Viewport *viewport, int width, bool perturbation = true);
@@ -0,0 +1,1194 @@
+#include "Render.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include "Perturbation.hpp"
+#include "Subdivision.hpp"
+
+
+// The orbits of every pixel in the given number type.
+template <typename Number>
+std::vector<Orbit<Number>>* orbitsOf(LastFrame* last) {
+    return &std::get<std::vector<Orbit<Number>>>(last->orbits);
+}
+
+
+// Forget the last frame before a new one is rendered into the iterations, and let go of
+// the orbits of another number type, they can be big.
+void startFrame(LastFrame* last, Precision precision) {
+    last->valid = false;
+    last->orbitsKept = false;
+    if (last->precision != precision) {
+        last->orbits = decltype(last->orbits)();
+        last->precision = precision;
+    }
+}
+
+
+// Remember what the iterations belong to once a frame is complete.
+void keepFrame(LastFrame* last, const Viewport* viewport, int maxI, bool orbitsKept) {
+    last->valid = true;
+    last->viewport = *viewport;
+    last->maxI = maxI;
+    last->orbitsKept = orbitsKept;
+}
+
+
+// Milliseconds since start.
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()
+                                                     - start).count();
+}
+
+
+// Reset the statistics for a new frame and start its clock.
+void startStats(ThreadPool* pool, FrameStats* stats) {
+    (*stats) = FrameStats();
+    stats->start = std::chrono::steady_clock::now();
+    stats->busyAtStart = pool->busySeconds();
+}
+
+
+// Color the frame from the amount of loops of every pixel, a row per task. Frames are
+// only ever colored here, so another palette never needs any iterating. Every frame and
+// every pass ends with coloring it, so this is where its timing is brought up to date,
+// and the loops are added up on the way.
+void colorizeFrame(ThreadPool* pool, const std::vector<int>& iterations,
+                   const ColorTable* colors, FrameBuffer* frameBuffer, FrameStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    const int width = frameBuffer->width;
+    const int maxI = colors->maxI;
+    std::vector<long long> workerLoops(pool->size(), 0);
+    pool->run(frameBuffer->height, [&](int y, int worker) {
+        const int* rowLoops = iterations.data() + static_cast<size_t>(y) * width;
+        colorize(colors, rowLoops, width, pixelAt(frameBuffer, 0, y));
+        long long loops = 0;
+        for (int x = 0; x < width; ++x) {
+            loops += std::min(rowLoops[x], maxI);
+        }
+        workerLoops[worker] += loops;
+    }, "colorize");
+
+    stats->colorizeMs += millisecondsSince(start);
+    stats->computeMs = millisecondsSince(stats->start) - stats->colorizeMs;
+    stats->loops = std::accumulate(workerLoops.begin(), workerLoops.end(), 0LL);
+    stats->workerBusy = pool->busySeconds();
+    for (size_t worker = 0; worker < stats->workerBusy.size(); ++worker) {
+        stats->workerBusy[worker] -= stats->busyAtStart[worker];
+    }
+}
+
+
+double loadImbalance(const FrameStats* stats) {
+    if (stats->workerBusy.empty()) {
+        return 1;
+    }
+    double total = std::accumulate(stats->workerBusy.begin(), stats->workerBusy.end(), 0.0);
+    double busiest = *std::max_element(stats->workerBusy.begin(), stats->workerBusy.end());
+    return total > 0 ? busiest * stats->workerBusy.size() / total : 1;
+}
+
+
+void traceFrame(Trace* trace, int lane, double start, double end, const FrameStats* stats) {
+    std::vector<std::pair<std::string, double>> args = {
+        {"compute ms", stats->computeMs},
+        {"colorize ms", stats->colorizeMs},
+        {"iterations", static_cast<double>(stats->loops)},
+        {"imbalance", loadImbalance(stats)}};
+    const double frameMs = stats->computeMs + stats->colorizeMs;
+    for (size_t worker = 0; worker < stats->workerBusy.size(); ++worker) {
+        const std::string name = "worker " + std::to_string(worker);
+        args.push_back({name + " busy ms", 1000 * stats->workerBusy[worker]});
+        args.push_back({name + " idle ms",
+                        std::max(0.0, frameMs - 1000 * stats->workerBusy[worker])});
+    }
+    trace->event("frame", lane, start, end, std::move(args));
+}
+
+
+// Coordinate of the (possibly fractional) pixel position i of size pixels between the
+// anchors from and to. Every renderer goes through here, so they all iterate exactly the
+// same complex values. The second half of the pixels is measured back from to, so if the
+// anchors are the negatives of each other, the coordinates are exact mirror images too.
+template <typename Number>
+inline Number pixelCoordinate(const Number& from, const Number& to, double i, int size) {
+    if (2 * i <= size) {
+        Number ratio = static_cast<Number>(i / size);
+        return from + (ratio * (to - from));
+    }
+    Number ratio = static_cast<Number>((size - i) / size);
+    return to - (ratio * (to - from));
+}
+
+
+// Compute the amount of loops of one tile of the frame into iterations. Each row of the
+// tile is handed to the row kernel in one go, which runs several pixels at once if the
+// CPU supports it. The complex value of pixel (x, y) is found by using the upperLeft and
+// lowerRight complex number anchors and the width and height of the window, all in the
+// number type the frame is rendered with.
+template <typename Number>
+void computeTile(const Tile& tile, int width, int height, const Complex<Number>& upperLeft,
+    const Complex<Number>& lowerRight, int maxI, bool interiorChecks,
+    RowKernel<Number> rowKernel, int* iterations) {
+    const int count = tile.x1 - tile.x0;
+    Number cReal[tileSize];
+    Number cImag[tileSize];
+
+    // real parts are the same for every row of the tile, so only compute them once
+    for (int x = tile.x0; x < tile.x1; ++x) {
+        cReal[x - tile.x0] = pixelCoordinate(upperLeft.real, lowerRight.real, x, width);
+    }
+
+    for (int y = tile.y0; y < tile.y1; ++y) {
+        std::fill(cImag, cImag + count,
+                  pixelCoordinate(upperLeft.imag, lowerRight.imag, y, height));
+        rowKernel(cReal, cImag, count, maxI, interiorChecks,
+                  iterations + static_cast<size_t>(y) * width + tile.x0, nullptr);
+    }
+}
+
+
+// Compute one tile of a deep zoom frame into iterations, iterating every pixel as a
+// difference to the reference orbit of the frame.
+void computeTilePerturbed(const Tile& tile, int width, int height, const DeepFrame& frame,
+    int maxI, int* iterations) {
+    for (int y = tile.y0; y < tile.y1; ++y) {
+        int* loops = iterations + static_cast<size_t>(y) * width;
+        for (int x = tile.x0; x < tile.x1; ++x) {
+            loops[x] = perturbedLoops(frame, x, y, width, height, maxI);
+        }
+    }
+}
+
+
+// Real parts of all columns and imaginary parts of all rows of the frame, for renderers
+// that don't go through the frame tile by tile.
+template <typename Number>
+void frameCoordinates(const Viewport* viewport, int width, int height,
+                      std::vector<Number>* cReal, std::vector<Number>* cImag) {
+    Complex<Number> upperLeft;
+    Complex<Number> lowerRight;
+    viewportAnchors(viewport, &upperLeft, &lowerRight);
+    cReal->resize(width);
+    cImag->resize(height);
+    for (int x = 0; x < width; ++x) {
+        (*cReal)[x] = pixelCoordinate(upperLeft.real, lowerRight.real, x, width);
+    }
+    for (int y = 0; y < height; ++y) {
+        (*cImag)[y] = pixelCoordinate(upperLeft.imag, lowerRight.imag, y, height);
+    }
+}
+
+
+// Coordinates of the samples of all columns and rows of a frame that is reprojected.
+template <typename Number>
+void sampleCoordinates(const Viewport* viewport, const AxisSamples& columns,
+                       const AxisSamples& rows, std::vector<Number>* cReal,
+                       std::vector<Number>* cImag) {
+    Complex<Number> upperLeft;
+    Complex<Number> lowerRight;
+    viewportAnchors(viewport, &upperLeft, &lowerRight);
+    const int width = static_cast<int>(columns.position.size());
+    const int height = static_cast<int>(rows.position.size());
+    cReal->resize(width);
+    cImag->resize(height);
+    for (int x = 0; x < width; ++x) {
+        (*cReal)[x] = pixelCoordinate(upperLeft.real, lowerRight.real, columns.position[x],
+                                      width);
+    }
+    for (int y = 0; y < height; ++y) {
+        (*cImag)[y] = pixelCoordinate(upperLeft.imag, lowerRight.imag, rows.position[y],
+                                      height);
+    }
+}
+
+
+// Rows of a frame that are mirror images of other rows across the real axis, from first
+// up to last exclusive, and the row each of them mirrors.
+struct MirroredRows {
+    int first = 0;
+    int last = 0;
+    // the row mirrored by row first + i
+    std::vector<int> source;
+};
+
+
+// Find the longest run of rows whose imaginary parts are the exact negatives of those of
+// rows on the other side of the real axis. The set is symmetric to the axis and so is
+// every kernel, so these rows have exactly the loops of their mirror images and don't
+// need to be iterated. Only exact negatives count, so a frame that isn't centered on the
+// axis only mirrors the rows that happen to line up; centered frames mirror all rows of
+// their shorter half thanks to pixelCoordinate(). The imaginary parts fall from row to
+// row, so the mirror images are found walking up from the bottom row.
+template <typename Number>
+MirroredRows mirroredRows(const std::vector<Number>& cImag) {
+    const int height = static_cast<int>(cImag.size());
+    std::vector<int> partner(height, -1);
+    int below = height - 1;
+    for (int y = 0; y < height && -cImag[y] < 0.0; ++y) {
+        while (below > y && cImag[below] + cImag[y] < 0.0) {
+            below--;
+        }
+        if (below > y && cImag[below] == -cImag[y]) {
+            partner[y] = below;
+            partner[below] = y;
+        }
+    }
+
+    // the rows of a run are all on one side of the axis, a row on it has no partner
+    MirroredRows mirrored;
+    for (int y = 0; y < height;) {
+        int end = y;
+        while (end < height && partner[end] >= 0
+               && (partner[end] > end) == (partner[y] > y)) {
+            end++;
+        }
+        if (end - y > mirrored.last - mirrored.first) {
+            mirrored.first = y;
+            mirrored.last = end;
+        }
+        y = std::max(end, y + 1);
+    }
+    mirrored.source.assign(partner.begin() + mirrored.first,
+                           partner.begin() + mirrored.last);
+    return mirrored;
+}
+
+
+// The tiles without the mirrored rows, which are cut out of the tiles they go through.
+std::vector<Tile> tilesOutside(const std::vector<Tile>& tiles, const MirroredRows& mirrored) {
+    std::vector<Tile> outside;
+    for (const Tile& tile : tiles) {
+        if (tile.y1 <= mirrored.first || tile.y0 >= mirrored.last) {
+            outside.push_back(tile);
+            continue;
+        }
+        if (tile.y0 < mirrored.first) {
+            outside.push_back({tile.x0, tile.y0, tile.x1, mirrored.first});
+        }
+        if (tile.y1 > mirrored.last) {
+            outside.push_back({tile.x0, mirrored.last, tile.x1, tile.y1});
+        }
+    }
+    return outside;
+}
+
+
+// Copy the loops of every mirrored row from the row it mirrors, a row per task, and the
+// orbits too unless they are nullptr, mirrored to the other side of the axis.
+template <typename Number>
+void mirrorRows(ThreadPool* pool, const MirroredRows& mirrored, int width, int* iterations,
+                Orbit<Number>* orbits) {
+    pool->run(mirrored.last - mirrored.first, [&](int index, int worker) {
+        const size_t to = static_cast<size_t>(mirrored.first + index) * width;
+        const size_t from = static_cast<size_t>(mirrored.source[index]) * width;
+        std::copy(iterations + from, iterations + from + width, iterations + to);
+        if (orbits == nullptr) {
+            return;
+        }
+        for (int x = 0; x < width; ++x) {
+            Orbit<Number> orbit = orbits[from + x];
+            orbit.z.imag = -orbit.z.imag;
+            orbit.saved.imag = -orbit.saved.imag;
+            orbits[to + x] = orbit;
+        }
+    }, "mirror");
+}
+
+
+// Round the viewport to the number type of the frame and let the pool work off all tiles,
+// except for the rows that mirror others if the fractal is symmetric to the real axis.
+// Returns how many pixels were mirrored.
+template <typename Number>
+long computeTiles(ThreadPool* pool, const Viewport* viewport, int width, int height,
+                  int maxI, bool interiorChecks, RowKernel<Number> rowKernel, bool mirror,
+                  std::vector<int>* iterations) {
+    std::vector<Number> cReal;
+    std::vector<Number> cImag;
+    frameCoordinates(viewport, width, height, &cReal, &cImag);
+    const MirroredRows mirrored = mirror ? mirroredRows(cImag) : MirroredRows();
+    const std::vector<Tile> tiles = tilesOutside(makeTiles(width, height), mirrored);
+    Complex<Number> upperLeft;
+    Complex<Number> lowerRight;
+    viewportAnchors(viewport, &upperLeft, &lowerRight);
+    pool->run(static_cast<int>(tiles.size()), [&](int index, int worker) {
+        computeTile(tiles[index], width, height, upperLeft, lowerRight, maxI, interiorChecks,
+                    rowKernel, iterations->data());
+    });
+    mirrorRows<Number>(pool, mirrored, width, iterations->data(), nullptr);
+    return static_cast<long>(mirrored.last - mirrored.first) * width;
+}
+
+
+// Pixel loops for the renderers that only iterate some pixels of a tile: gather the
+// coordinates of the pixels (xs[i], ys[i]) and hand them to the row kernel in one go,
+// even if they are from different rows. count is at most tileSize. Unless orbits is
+// nullptr, the orbit of every pixel is kept there, at its place in the frame.
+template <typename Number>
+auto gatheredPixelLoops(const std::vector<Number>& cReal, const std::vector<Number>& cImag,
+                        int maxI, bool interiorChecks, RowKernel<Number> rowKernel,
+                        Orbit<Number>* orbits) {
+    const int width = static_cast<int>(cReal.size());
+    return [&cReal, &cImag, maxI, interiorChecks, rowKernel, width, orbits]
+           (const int* xs, const int* ys, int count, int* loops) {
+        Number real[tileSize];
+        Number imag[tileSize];
+        Orbit<Number> pixelOrbits[tileSize];
+        for (int i = 0; i < count; ++i) {
+            real[i] = cReal[xs[i]];
+            imag[i] = cImag[ys[i]];
+        }
+        rowKernel(real, imag, count, maxI, interiorChecks, loops,
+                  orbits == nullptr ? nullptr : pixelOrbits);
+        if (orbits != nullptr) {
+            for (int i = 0; i < count; ++i) {
+                orbits[static_cast<size_t>(ys[i]) * width + xs[i]] = pixelOrbits[i];
+            }
+        }
+    };
+}
+
+
+// Iterate count pixels at (xs[i], ys[i]) with pixelLoops(xs, ys, count, loops), which
+// takes at most tileSize of them at once. Returns early once cancel is set, which may be
+// nullptr if that can't happen.
+template <typename PixelLoops>
+void computePixels(const int* xs, const int* ys, int count, const PixelLoops& pixelLoops,
+                   const std::atomic<bool>* cancel, int* loops) {
+    for (int i = 0; i < count; i += tileSize) {
+        if (cancel != nullptr && *cancel) {
+            return;
+        }
+        pixelLoops(xs + i, ys + i, std::min(tileSize, count - i), loops + i);
+    }
+}
+
+
+// Render the frame by subdivision with the row kernel of the frame's number type. The
+// real parts of all columns and imaginary parts of all rows are computed once, so a
+// span only has to repeat the part that stays the same along it.
+template <typename Number>
+void computeSubdividedKernel(ThreadPool* pool, const Viewport* viewport, int width,
+                             int height, int maxI, bool interiorChecks,
+                             RowKernel<Number> rowKernel, std::vector<int>* iterations,
+                             SubdivisionStats* stats, const std::atomic<bool>* cancel) {
+    std::vector<Number> cReal;
+    std::vector<Number> cImag;
+    frameCoordinates(viewport, width, height, &cReal, &cImag);
+    computeSubdivided(pool, width, height,
+                      [&](int x, int y, int count, bool vertical, int* loops) {
+        Number same[maxSpanLength];
+        if (vertical) {
+            std::fill(same, same + count, cReal[x]);
+            rowKernel(same, cImag.data() + y, count, maxI, interiorChecks, loops, nullptr);
+        } else {
+            std::fill(same, same + count, cImag[y]);
+            rowKernel(cReal.data() + x, same, count, maxI, interiorChecks, loops, nullptr);
+        }
+    }, iterations, stats, cancel);
+}
+
+
+// Render the frame by subdivision, with every pixel the borders need iterated as
+// usual. Gives up with the iterations incomplete once cancel is set, which may be
+// nullptr if that can't happen.
+void divideAndConquerSubdivided(ThreadPool* pool, const Viewport* viewport, int width,
+                                int height, int maxI, bool interiorChecks,
+                                const RowKernels* rowKernels, Precision precision,
+                                bool seriesApproximation, std::vector<int>* iterations,
+                                FrameStats* stats, const std::atomic<bool>* cancel) {
+    SubdivisionStats subdivision;
+    DeepFrame frame;
+    switch (precision) {
+        case PrecisionFloat:
+            computeSubdividedKernel(pool, viewport, width, height, maxI, interiorChecks,
+                                    rowKernels->floatKernel, iterations, &subdivision,
+                                    cancel);
+            break;
+        case PrecisionDouble:
+            computeSubdividedKernel(pool, viewport, width, height, maxI, interiorChecks,
+                                    rowKernels->doubleKernel, iterations, &subdivision,
+                                    cancel);
+            break;
+        case PrecisionDoubleDouble:
+            computeSubdividedKernel(pool, viewport, width, height, maxI, interiorChecks,
+                                    rowKernels->doubleDoubleKernel, iterations,
+                                    &subdivision, cancel);
+            break;
+        case PrecisionQuadDouble:
+            computeSubdividedKernel(pool, viewport, width, height, maxI, interiorChecks,
+                                    rowKernels->quadDoubleKernel, iterations,
+                                    &subdivision, cancel);
+            break;
+        case PrecisionPerturbation:
+            prepareDeepFrame(viewport, width, maxI, seriesApproximation, &frame);
+            stats->skipped = frame.skip;
+            computeSubdivided(pool, width, height,
+                              [&](int x, int y, int count, bool vertical, int* loops) {
+                for (int i = 0; i < count; ++i) {
+                    loops[i] = vertical
+                        ? perturbedLoops(frame, x, y + i, width, height, maxI)
+                        : perturbedLoops(frame, x + i, y, width, height, maxI);
+                }
+            }, iterations, &subdivision, cancel);
+            break;
+    }
+    if (cancel != nullptr && *cancel) {
+        return;
+    }
+    stats->subdivided = true;
+    stats->computedPixels = subdivision.computed;
+    stats->filledPixels = subdivision.filled;
+}
+
+
+// Compute one tile of a reprojected frame. Pixels whose column and row are both reused
+// take the amount of loops of the last frame, the others are collected from all rows of
+// the tile and iterated at their samples with pixelLoops(xs, ys, count, loops), so the
+// kernel gets full vectors even where only a few pixels of each row are missing. Returns
+// how many pixels were reused.
+template <typename PixelLoops>
+long computeTileReprojected(const Tile& tile, int width, const AxisSamples& columns,
+                            const AxisSamples& rows, const std::vector<int>& lastLoops,
+                            const PixelLoops& pixelLoops, std::vector<int>* iterations) {
+    int xs[tileSize * tileSize];
+    int ys[tileSize * tileSize];
+    int computed[tileSize * tileSize];
+    int count = 0;
+    long reused = 0;
+    for (int y = tile.y0; y < tile.y1; ++y) {
+        int* loops = iterations->data() + static_cast<size_t>(y) * width;
+        const int* last = rows.source[y] < 0 ? nullptr
+            : lastLoops.data() + static_cast<size_t>(rows.source[y]) * width;
+        for (int x = tile.x0; x < tile.x1; ++x) {
+            if (last != nullptr && columns.source[x] >= 0) {
+                loops[x] = last[columns.source[x]];
+                reused++;
+            } else {
+                xs[count] = x;
+                ys[count] = y;
+                count++;
+            }
+        }
+    }
+
+    computePixels(xs, ys, count, pixelLoops, nullptr, computed);
+    for (int i = 0; i < count; ++i) {
+        iterations->data()[static_cast<size_t>(ys[i]) * width + xs[i]] = computed[i];
+    }
+    return reused;
+}
+
+
+// Let the pool work off all tiles of a reprojected frame. Returns how many pixels were
+// reused.
+template <typename PixelLoops>
+long computeReprojected(ThreadPool* pool, int width, int height,
+                        const AxisSamples& columns, const AxisSamples& rows,
+                        const std::vector<int>& lastLoops, const PixelLoops& pixelLoops,
+                        std::vector<int>* iterations) {
+    std::vector<Tile> tiles = makeTiles(width, height);
+    std::vector<long> reused(pool->size(), 0);
+    pool->run(static_cast<int>(tiles.size()), [&](int index, int worker) {
+        reused[worker] += computeTileReprojected(tiles[index], width, columns, rows,
+                                                 lastLoops, pixelLoops, iterations);
+    });
+    return std::accumulate(reused.begin(), reused.end(), 0L);
+}
+
+
+// Iterate the missing pixels of a reprojected frame with the row kernel of the frame's
+// number type.
+template <typename Number>
+long computeReprojectedKernel(ThreadPool* pool, const Viewport* viewport, int width,
+                              int height, int maxI, bool interiorChecks,
+                              RowKernel<Number> rowKernel, const AxisSamples& columns,
+                              const AxisSamples& rows, const std::vector<int>& lastLoops,
+                              std::vector<int>* iterations) {
+    std::vector<Number> cReal;
+    std::vector<Number> cImag;
+    sampleCoordinates(viewport, columns, rows, &cReal, &cImag);
+    return computeReprojected(pool, width, height, columns, rows, lastLoops,
+                              gatheredPixelLoops<Number>(cReal, cImag, maxI, interiorChecks,
+                                                         rowKernel, nullptr),
+                              iterations);
+}
+
+
+// Render the frame on the grid of samples that reuses as much of the last frame as the
+// tolerance allows, iterating only the pixels that are missing, and keep a copy of the
+// frame as the last one for the next frame.
+void divideAndConquerReprojected(ThreadPool* pool, const Viewport* viewport, int width,
+                                 int height, int maxI, bool interiorChecks,
+                                 const RowKernels* rowKernels, Precision precision,
+                                 bool seriesApproximation, Reprojection* reprojection,
+                                 std::vector<int>* iterations, FrameStats* stats) {
+    AxisSamples columns;
+    AxisSamples rows;
+    reproject(reprojection, viewport, width, height, maxI, &columns, &rows);
+    iterations->resize(static_cast<size_t>(width) * height);
+    const std::vector<int>& lastLoops = reprojection->loops;
+    long reused = 0;
+    DeepFrame frame;
+
+    switch (precision) {
+        case PrecisionFloat:
+            reused = computeReprojectedKernel(pool, viewport, width, height, maxI,
+                                              interiorChecks, rowKernels->floatKernel,
+                                              columns, rows, lastLoops, iterations);
+            break;
+        case PrecisionDouble:
+            reused = computeReprojectedKernel(pool, viewport, width, height, maxI,
+                                              interiorChecks, rowKernels->doubleKernel,
+                                              columns, rows, lastLoops, iterations);
+            break;
+        case PrecisionDoubleDouble:
+            reused = computeReprojectedKernel(pool, viewport, width, height, maxI,
+                                              interiorChecks, rowKernels->doubleDoubleKernel,
+                                              columns, rows, lastLoops, iterations);
+            break;
+        case PrecisionQuadDouble:
+            reused = computeReprojectedKernel(pool, viewport, width, height, maxI,
+                                              interiorChecks, rowKernels->quadDoubleKernel,
+                                              columns, rows, lastLoops, iterations);
+            break;
+        case PrecisionPerturbation:
+            prepareDeepFrame(viewport, width, maxI, seriesApproximation, &frame);
+            stats->skipped = frame.skip;
+            reused = computeReprojected(pool, width, height, columns, rows, lastLoops,
+                                        [&](const int* xs, const int* ys, int count,
+                                            int* loops) {
+                for (int i = 0; i < count; ++i) {
+                    loops[i] = perturbedLoops(frame, columns.position[xs[i]],
+                                              rows.position[ys[i]], width, height, maxI);
+                }
+            }, iterations);
+            break;
+    }
+    stats->reprojected = true;
+    stats->reusedPixels = reused;
+
+    reprojection->valid = true;
+    reprojection->viewport = *viewport;
+    reprojection->maxI = maxI;
+    reprojection->columns = std::move(columns);
+    reprojection->rows = std::move(rows);
+    reprojection->loops = *iterations;
+}
+
+
+// Split the frame into tiles and let the worker pool compute them, using the row kernel
+// of the precision the frame is rendered with.
+void divideAndConquerTiles(ThreadPool* pool, const Viewport* viewport, int width, int height,
+                           int maxI, bool interiorChecks, const RowKernels* rowKernels,
+                           Precision precision, bool seriesApproximation,
+                           std::vector<int>* iterations, FrameStats* stats) {
+    std::vector<Tile> tiles = makeTiles(width, height);
+    const bool mirror = rowKernels->conjugateSymmetric;
+    DeepFrame frame;
+
+    // divide work among worker
+    switch (precision) {
+        case PrecisionFloat:
+            stats->mirroredPixels = computeTiles(pool, viewport, width, height, maxI,
+                                                 interiorChecks, rowKernels->floatKernel,
+                                                 mirror, iterations);
+            break;
+        case PrecisionDouble:
+            stats->mirroredPixels = computeTiles(pool, viewport, width, height, maxI,
+                                                 interiorChecks, rowKernels->doubleKernel,
+                                                 mirror, iterations);
+            break;
+        case PrecisionDoubleDouble:
+            stats->mirroredPixels = computeTiles(pool, viewport, width, height, maxI,
+                                                 interiorChecks,
+                                                 rowKernels->doubleDoubleKernel, mirror,
+                                                 iterations);
+            break;
+        case PrecisionQuadDouble:
+            stats->mirroredPixels = computeTiles(pool, viewport, width, height, maxI,
+                                                 interiorChecks,
+                                                 rowKernels->quadDoubleKernel, mirror,
+                                                 iterations);
+            break;
+        case PrecisionPerturbation:
+            prepareDeepFrame(viewport, width, maxI, seriesApproximation, &frame);
+            stats->skipped = frame.skip;
+            pool->run(static_cast<int>(tiles.size()), [&](int index, int worker) {
+                computeTilePerturbed(tiles[index], width, height, frame, maxI,
+                                     iterations->data());
+            });
+            break;
+    }
+}
+
+
+// Render the amount of loops of every pixel into iterations, then color the frame buffer
+// from them. With subdivision, uniform areas are filled in instead of iterated. With a
+// reprojection, pixels of the last frame are reused where possible; it may be nullptr to
+// render every pixel from scratch.
+void divideAndConquer(ThreadPool* pool, const Viewport* viewport, int width, int height,
+                            int maxI, bool interiorChecks, const RowKernels* rowKernels,
+                            Precision precision, bool seriesApproximation, bool subdivision,
+                            Reprojection* reprojection, std::vector<int>* iterations,
+                            LastFrame* last, const ColorTable* colors,
+                            FrameBuffer* frameBuffer, FrameStats* stats) {
+    startStats(pool, stats);
+    startFrame(last, precision);
+    iterations->resize(static_cast<size_t>(width) * height);
+    if (subdivision) {
+        divideAndConquerSubdivided(pool, viewport, width, height, maxI, interiorChecks,
+                                   rowKernels, precision, seriesApproximation, iterations,
+                                   stats, nullptr);
+    } else if (reprojection != nullptr) {
+        divideAndConquerReprojected(pool, viewport, width, height, maxI, interiorChecks,
+                                    rowKernels, precision, seriesApproximation, reprojection,
+                                    iterations, stats);
+    } else {
+        divideAndConquerTiles(pool, viewport, width, height, maxI, interiorChecks,
+                              rowKernels, precision, seriesApproximation, iterations, stats);
+    }
+    colorizeFrame(pool, *iterations, colors, frameBuffer, stats);
+    if (stats->reusedPixels == 0) {
+        keepFrame(last, viewport, maxI, false);
+    }
+}
+
+
+// Pixel step of the first and coarsest pass of a progressively rendered frame. Every
+// following pass halves it until the frame is at full resolution, so it has to be a power
+// of two that divides tileSize.
+const int coarsestPassStep = 8;
+
+
+// Compute the pixels of one tile that are new in the pass with the given step: every
+// step-th pixel of every step-th row, except the ones the previous pass with twice the
+// step already computed. They are iterated with pixelLoops(xs, ys, count, loops) all
+// together, so the few pixels a coarse pass has in each row still fill whole vectors.
+// Each pixel is written as a step x step block to the bottom right, so the frame is
+// complete after every pass, and once the step is 1 every pixel has its own exact loops.
+template <typename PixelLoops>
+void computeTilePass(const Tile& tile, int width, int step, const PixelLoops& pixelLoops,
+                     const std::atomic<bool>& cancel, int* iterations) {
+    int xs[tileSize * tileSize];
+    int ys[tileSize * tileSize];
+    int loops[tileSize * tileSize];
+    int count = 0;
+    for (int y = tile.y0; y < tile.y1; y += step) {
+        // every other pixel of the rows the previous pass went through is done already
+        const bool previousRow = step < coarsestPassStep && (y - tile.y0) % (2 * step) == 0;
+        const int stride = previousRow ? 2 * step : step;
+        for (int x = previousRow ? tile.x0 + step : tile.x0; x < tile.x1; x += stride) {
+            xs[count] = x;
+            ys[count] = y;
+            count++;
+        }
+    }
+    computePixels(xs, ys, count, pixelLoops, &cancel, loops);
+    if (cancel) {
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const int blockWidth = std::min(step, tile.x1 - xs[i]);
+        const int blockHeight = std::min(step, tile.y1 - ys[i]);
+        for (int row = ys[i]; row < ys[i] + blockHeight; ++row) {
+            int* block = iterations + static_cast<size_t>(row) * width + xs[i];
+            std::fill(block, block + blockWidth, loops[i]);
+        }
+    }
+}
+
+
+// Run the passes from coarsestPassStep down to lastStep, each one over the tiles on the
+// pool, fill in the rest of the frame with fillIn() after every pass, color the frame
+// and report the passes that weren't cancelled to passDone(step).
+template <typename PixelLoops, typename FillIn>
+void computePasses(ThreadPool* pool, const std::vector<Tile>& tiles, int width,
+                   int lastStep, const PixelLoops& pixelLoops, const FillIn& fillIn,
+                   const std::atomic<bool>& cancel, std::vector<int>* iterations,
+                   const ColorTable* colors, FrameBuffer* frameBuffer, FrameStats* stats,
+                   const std::function<void(int)>& passDone) {
+    for (int step = coarsestPassStep; step >= lastStep; step /= 2) {
+        pool->run(static_cast<int>(tiles.size()), [&](int index, int worker) {
+            computeTilePass(tiles[index], width, step, pixelLoops, cancel,
+                            iterations->data());
+        });
+        if (cancel) {
+            return;
+        }
+        fillIn();
+        colorizeFrame(pool, *iterations, colors, frameBuffer, stats);
+        passDone(step);
+    }
+}
+
+
+// Run the passes with the row kernel of the frame's number type, which gets the pixels
+// of a pass gathered from the coordinates of the whole frame, mirroring rows if mirror is
+// set. Unless last is nullptr, the orbits of all pixels are kept there.
+template <typename Number>
+void computePassesKernel(ThreadPool* pool, const Viewport* viewport, int width, int height,
+                         int maxI, bool interiorChecks, RowKernel<Number> rowKernel,
+                         bool mirror, int lastStep, LastFrame* last,
+                         const std::atomic<bool>& cancel,
+                         std::vector<int>* iterations, const ColorTable* colors,
+                         FrameBuffer* frameBuffer, FrameStats* stats,
+                         const std::function<void(int)>& passDone) {
+    std::vector<Number> cReal;
+    std::vector<Number> cImag;
+    frameCoordinates(viewport, width, height, &cReal, &cImag);
+    Orbit<Number>* orbits = nullptr;
+    if (last != nullptr) {
+        orbitsOf<Number>(last)->resize(static_cast<size_t>(width) * height);
+        orbits = orbitsOf<Number>(last)->data();
+    }
+    const MirroredRows mirrored = mirror ? mirroredRows(cImag) : MirroredRows();
+    stats->mirroredPixels = static_cast<long>(mirrored.last - mirrored.first) * width;
+    computePasses(pool, tilesOutside(makeTiles(width, height), mirrored), width, lastStep,
+                  gatheredPixelLoops(cReal, cImag, maxI, interiorChecks, rowKernel, orbits),
+                  [&]() {
+                      mirrorRows(pool, mirrored, width, iterations->data(), orbits);
+                  }, cancel, iterations, colors, frameBuffer, stats, passDone);
+}
+
+
+// Continue every running pixel of the last frame up to the new max loops with the
+// orbit it stopped at. Exploded pixels keep their amount of loops, so lowering max loops
+// only needs coloring again, and pixels inside the set get the most loops there are, so
+// they stay black at any max loops. The amount of loops and the orbit of a pixel always
+// belong together, so a cancelled continuation can be continued again, and colored at
+// the max loops of the last frame. The orbits are resumed by the row kernel of the frame,
+// which knows the fractal they belong to. Returns how many pixels were continued.
+template <typename Number>
+long continueFrame(ThreadPool* pool, const Viewport* viewport, int width, int height,
+                   int maxI, bool interiorChecks, RowKernel<Number> rowKernel,
+                   LastFrame* last, std::vector<int>* iterations,
+                   const std::atomic<bool>& cancel) {
+    std::vector<Number> cReal;
+    std::vector<Number> cImag;
+    frameCoordinates(viewport, width, height, &cReal, &cImag);
+    std::vector<Orbit<Number>>& orbits = *orbitsOf<Number>(last);
+    std::vector<Tile> tiles = makeTiles(width, height);
+    std::vector<long> continued(pool->size(), 0);
+
+    pool->run(static_cast<int>(tiles.size()), [&](int index, int worker) {
+        const Tile& tile = tiles[index];
+        if (cancel) {
+            return;
+        }
+        for (int y = tile.y0; y < tile.y1; ++y) {
+            for (int x = tile.x0; x < tile.x1; ++x) {
+                size_t i = static_cast<size_t>(y) * width + x;
+                int& loops = (*iterations)[i];
+                if (orbits[i].status == OrbitInside) {
+                    loops = std::numeric_limits<int>::max();
+                } else if (orbits[i].status == OrbitRunning && loops < maxI) {
+                    Complex<Number> c;
+                    initComplex(&c, cReal[x], cImag[y]);
+                    loops = rowKernel.resume(&c, loops, maxI, interiorChecks, &orbits[i]);
+                    continued[worker]++;
+                }
+            }
+        }
+    });
+    return std::accumulate(continued.begin(), continued.end(), 0L);
+}
+
+
+// Render the frame from coarse to fine into the frame buffer, calling passDone(step)
+// after every pass, so the first picture is there after a 1/64 of the work. Every pass
+// only computes the pixels that are new to it and keeps the rest, so all passes together
+// cost as much as rendering the frame in one go and end up with exactly the same pixels.
+// With subdivision, the coarsest pass is followed by the subdivided frame right away,
+// since that one doesn't iterate most pixels anyway. If the last frame showed the same
+// view, it is only continued or colored again instead. Returns early once cancel is set.
+void renderProgressive(ThreadPool* pool, const Viewport* viewport, int width, int height,
+                       int maxI, bool interiorChecks, const RowKernels* rowKernels,
+                       Precision precision, bool seriesApproximation, bool subdivision,
+                       std::vector<int>* iterations, LastFrame* last,
+                       const ColorTable* colors, FrameBuffer* frameBuffer,
+                       FrameStats* stats, const std::atomic<bool>& cancel,
+                       const std::function<void(int)>& passDone) {
+    startStats(pool, stats);
+
+    // only max loops or the palette changed since the last frame, so pick up where it
+    // stopped or just color it again
+    if (last->valid && last->precision == precision
+        && sameViewport(&last->viewport, viewport)
+        && (last->maxI == maxI || last->orbitsKept)) {
+        if (last->maxI != maxI) {
+            switch (precision) {
+                case PrecisionFloat:
+                    stats->continuedPixels = continueFrame<float>(pool, viewport,
+                        width, height, maxI, interiorChecks, rowKernels->floatKernel,
+                        last, iterations, cancel);
+                    break;
+                case PrecisionDouble:
+                    stats->continuedPixels = continueFrame<double>(pool, viewport,
+                        width, height, maxI, interiorChecks, rowKernels->doubleKernel,
+                        last, iterations, cancel);
+                    break;
+                case PrecisionDoubleDouble:
+                    stats->continuedPixels = continueFrame<DoubleDouble>(pool, viewport,
+                        width, height, maxI, interiorChecks, rowKernels->doubleDoubleKernel,
+                        last, iterations, cancel);
+                    break;
+                case PrecisionQuadDouble:
+                    stats->continuedPixels = continueFrame<QuadDouble>(pool, viewport,
+                        width, height, maxI, interiorChecks, rowKernels->quadDoubleKernel,
+                        last, iterations, cancel);
+                    break;
+                case PrecisionPerturbation:
+                    break;
+            }
+            stats->continued = true;
+            if (cancel) {
+                return;
+            }
+            last->maxI = maxI;
+        }
+        colorizeFrame(pool, *iterations, colors, frameBuffer, stats);
+        passDone(1);
+        return;
+    }
+
+    const int lastStep = subdivision ? coarsestPassStep : 1;
+    const bool keepOrbits = !subdivision && precision != PrecisionPerturbation;
+    startFrame(last, precision);
+    iterations->resize(static_cast<size_t>(width) * height);
+    LastFrame* orbits = keepOrbits ? last : nullptr;
+    const bool mirror = rowKernels->conjugateSymmetric;
+    DeepFrame frame;
+
+    switch (precision) {
+        case PrecisionFloat:
+            computePassesKernel(pool, viewport, width, height, maxI, interiorChecks,
+                                rowKernels->floatKernel, mirror, lastStep, orbits,
+                                cancel, iterations, colors, frameBuffer, stats, passDone);
+            break;
+        case PrecisionDouble:
+            computePassesKernel(pool, viewport, width, height, maxI, interiorChecks,
+                                rowKernels->doubleKernel, mirror, lastStep, orbits,
+                                cancel, iterations, colors, frameBuffer, stats, passDone);
+            break;
+        case PrecisionDoubleDouble:
+            computePassesKernel(pool, viewport, width, height, maxI, interiorChecks,
+                                rowKernels->doubleDoubleKernel, mirror, lastStep, orbits,
+                                cancel, iterations, colors, frameBuffer, stats, passDone);
+            break;
+        case PrecisionQuadDouble:
+            computePassesKernel(pool, viewport, width, height, maxI, interiorChecks,
+                                rowKernels->quadDoubleKernel, mirror, lastStep, orbits,
+                                cancel, iterations, colors, frameBuffer, stats, passDone);
+            break;
+        case PrecisionPerturbation:
+            prepareDeepFrame(viewport, width, maxI, seriesApproximation, &frame);
+            stats->skipped = frame.skip;
+            computePasses(pool, makeTiles(width, height), width, lastStep,
+                          [&](const int* xs, const int* ys, int count, int* loops) {
+                for (int i = 0; i < count; ++i) {
+                    loops[i] = perturbedLoops(frame, xs[i], ys[i], width, height, maxI);
+                }
+            }, []() {}, cancel, iterations, colors, frameBuffer, stats, passDone);
+            break;
+    }
+
+    if (subdivision && !cancel) {
+        divideAndConquerSubdivided(pool, viewport, width, height, maxI, interiorChecks,
+                                   rowKernels, precision, seriesApproximation, iterations,
+                                   stats, &cancel);
+        if (!cancel) {
+            colorizeFrame(pool, *iterations, colors, frameBuffer, stats);
+            passDone(1);
+        }
+    }
+
+    if (!cancel) {
+        keepFrame(last, viewport, maxI, keepOrbits);
+    }
+}
+
+
+// Samples of the cache are counted in 64 bits, with room to spare for the tile corners.
+const int64_t cacheSampleLimit = int64_t(1) << 62;
+
+
+// Index of the tile a sample is in, rounding down also left of and below 0.
+static int64_t tileOf(int64_t sample) {
+    return sample >= 0 ? sample / cacheTileSize : -((-sample - 1) / cacheTileSize) - 1;
+}
+
+
+// Multiply by 2^exponent, which may be negative.
+static void scaleByPowerOfTwo(mpf_class* value, long exponent) {
+    if (exponent >= 0) {
+        mpf_mul_2exp(value->get_mpf_t(), value->get_mpf_t(), exponent);
+    } else {
+        mpf_div_2exp(value->get_mpf_t(), value->get_mpf_t(), -exponent);
+    }
+}
+
+
+// The sample of the cache level closest to every pixel along one axis of the frame, which
+// starts at from and goes span over size pixels. direction is -1 for the imaginary axis,
+// whose samples count downwards. Returns false if the samples are too far out to count.
+static bool nearestSamples(const mpf_class& from, const mpf_class& span, int size,
+                           int level, int direction, std::vector<int64_t>* samples) {
+    mpf_class position(0, std::max<mp_bitcnt_t>(from.get_prec(), std::max(0, level) + 64));
+    samples->resize(size);
+    for (int i = 0; i < size; ++i) {
+        position = (from + span * i / size) * direction;
+        scaleByPowerOfTwo(&position, level);
+        position += 0.5;
+        mpf_floor(position.get_mpf_t(), position.get_mpf_t());
+        if (!mpf_fits_slong_p(position.get_mpf_t())) {
+            return false;
+        }
+        const int64_t sample = position.get_si();
+        if (sample <= -cacheSampleLimit || sample >= cacheSampleLimit) {
+            return false;
+        }
+        (*samples)[i] = sample;
+    }
+    return true;
+}
+
+
+// The part of the complex plane a tile of the cache covers, so rendering it as a frame of
+// cacheTileSize x cacheTileSize pixels iterates exactly the samples of the tile. Every
+// corner is a 63 bit integer times a power of two, so it is exact at any level.
+static void tileViewport(const TileKey& key, Viewport* viewport) {
+    const mp_bitcnt_t precision = 128;
+    mpf_class step(1, precision);
+    scaleByPowerOfTwo(&step, -key.level);
+    viewport->center.real.set_prec(precision);
+    viewport->center.imag.set_prec(precision);
+    viewport->spanReal.set_prec(precision);
+    viewport->spanImag.set_prec(precision);
+    viewport->center.real = step * (key.x * cacheTileSize + cacheTileSize / 2);
+    viewport->center.imag = -step * (key.y * cacheTileSize + cacheTileSize / 2);
+    viewport->spanReal = step * cacheTileSize;
+    viewport->spanImag = -step * cacheTileSize;
+}
+
+
+// Iterate the samples of a tile of the cache with the row kernel of the number type.
+template <typename Number>
+void computeCacheTileKernel(const Viewport* viewport, int maxI, bool interiorChecks,
+                            RowKernel<Number> rowKernel, int* loops) {
+    Complex<Number> upperLeft;
+    Complex<Number> lowerRight;
+    viewportAnchors(viewport, &upperLeft, &lowerRight);
+    for (const Tile& tile : makeTiles(cacheTileSize, cacheTileSize)) {
+        computeTile(tile, cacheTileSize, cacheTileSize, upperLeft, lowerRight, maxI,
+                    interiorChecks, rowKernel, loops);
+    }
+}
+
+
+static void computeCacheTile(const Viewport* viewport, Precision precision, int maxI,
+                             bool interiorChecks, const RowKernels* rowKernels, int* loops) {
+    switch (precision) {
+        case PrecisionFloat:
+            computeCacheTileKernel(viewport, maxI, interiorChecks, rowKernels->floatKernel,
+                                   loops);
+            break;
+        case PrecisionDouble:
+            computeCacheTileKernel(viewport, maxI, interiorChecks, rowKernels->doubleKernel,
+                                   loops);
+            break;
+        case PrecisionDoubleDouble:
+            computeCacheTileKernel(viewport, maxI, interiorChecks,
+                                   rowKernels->doubleDoubleKernel, loops);
+            break;
+        case PrecisionQuadDouble:
+            computeCacheTileKernel(viewport, maxI, interiorChecks,
+                                   rowKernels->quadDoubleKernel, loops);
+            break;
+        case PrecisionPerturbation:
+            break;
+    }
+}
+
+
+bool renderCached(ThreadPool* pool, TileCache* cache, const Viewport* viewport, int width,
+                  int height, int maxI, bool interiorChecks, const RowKernels* rowKernels,
+                  std::vector<int>* iterations, LastFrame* last, const ColorTable* colors,
+                  FrameBuffer* frameBuffer, FrameStats* stats,
+                  const std::atomic<bool>* cancel) {
+    if (!hasPerturbation(rowKernels)) {
+        return false;
+    }
+    // every level halves the spacing of the one before, so the closest level is the
+    // rounded binary logarithm of the pixel spacing, which can't underflow like a double
+    const mp_bitcnt_t precision = viewport->center.real.get_prec();
+    mpf_class spacing(0, precision);
+    spacing = viewport->spanReal / width;
+    long exponent;
+    double mantissa = mpf_get_d_2exp(&exponent, spacing.get_mpf_t());
+    const int level = static_cast<int>(-lround(exponent + log2(mantissa)));
+
+    mpf_class left(0, precision);
+    mpf_class top(0, precision);
+    left = viewport->center.real - viewport->spanReal / 2;
+    top = viewport->center.imag - viewport->spanImag / 2;
+    std::vector<int64_t> columns;
+    std::vector<int64_t> rows;
+    if (!nearestSamples(left, viewport->spanReal, width, level, 1, &columns)
+        || !nearestSamples(top, viewport->spanImag, height, level, -1, &rows)) {
+        return false;
+    }
+    const int64_t firstX = tileOf(columns.front());
+    const int64_t firstY = tileOf(rows.front());
+    const size_t tilesX = tileOf(columns.back()) - firstX + 1;
+    const size_t tilesY = tileOf(rows.back()) - firstY + 1;
+    // found tiles have to stay where they are until the frame is put together
+    if (tilesX * tilesY > cache->capacity()) {
+        return false;
+    }
+
+    startStats(pool, stats);
+    std::vector<TileKey> keys;
+    std::vector<const int*> tileLoops;
+    std::vector<size_t> missing;
+    for (size_t y = 0; y < tilesY; ++y) {
+        for (size_t x = 0; x < tilesX; ++x) {
+            TileKey key = {level, maxI, firstX + static_cast<int64_t>(x),
+                           firstY + static_cast<int64_t>(y), interiorChecks};
+            keys.push_back(key);
+            tileLoops.push_back(cache->find(key));
+            if (tileLoops.back() == nullptr) {
+                missing.push_back(keys.size() - 1);
+            }
+        }
+    }
+    std::vector<Viewport> tileViewports(missing.size());
+    std::vector<Precision> tilePrecisions(missing.size());
+    for (size_t i = 0; i < missing.size(); ++i) {
+        tileViewport(keys[missing[i]], &tileViewports[i]);
+        tilePrecisions[i] = choosePrecision(&tileViewports[i], cacheTileSize);
+        if (tilePrecisions[i] == PrecisionPerturbation) {
+            return false;
+        }
+    }
+
+    // tiles finished before the frame is cancelled are still stored for the next one
+    std::vector<int> computed(missing.size() * cacheTilePixels);
+    std::vector<char> done(missing.size(), false);
+    pool->run(static_cast<int>(missing.size()), [&](int index, int worker) {
+        if (cancel != nullptr && *cancel) {
+            return;
+        }
+        computeCacheTile(&tileViewports[index], tilePrecisions[index], maxI, interiorChecks,
+                         rowKernels, computed.data() + index * cacheTilePixels);
+        done[index] = true;
+    });
+    for (size_t i = 0; i < missing.size(); ++i) {
+        if (done[i]) {
+            tileLoops[missing[i]] = cache->store(keys[missing[i]],
+                                                 computed.data() + i * cacheTilePixels);
+        }
+    }
+    if (cancel != nullptr && *cancel) {
+        return true;
+    }
+
+    // every pixel of a column takes its samples from the same column of the tiles, and
+    // every pixel of a row from the same row
+    std::vector<size_t> columnTile(width);
+    std::vector<int> columnOffset(width);
+    for (int x = 0; x < width; ++x) {
+        columnTile[x] = tileOf(columns[x]) - firstX;
+        columnOffset[x] = static_cast<int>(columns[x] - tileOf(columns[x]) * cacheTileSize);
+    }
+    startFrame(last, last->precision);
+    iterations->resize(static_cast<size_t>(width) * height);
+    pool->run(height, [&](int y, int worker) {
+        const int64_t tile = tileOf(rows[y]);
+        const int* const* rowTiles = tileLoops.data() + (tile - firstY) * tilesX;
+        const int offset = static_cast<int>(rows[y] - tile * cacheTileSize) * cacheTileSize;
+        int* rowLoops = iterations->data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            rowLoops[x] = rowTiles[columnTile[x]][offset + columnOffset[x]];
+        }
+    }, "cache");
+
+    stats->cached = true;
+    stats->cachedTiles = static_cast<long>(keys.size() - missing.size());
+    stats->computedTiles = static_cast<long>(missing.size());
+    colorizeFrame(pool, *iterations, colors, frameBuffer, stats);
+    return true;
+}
+
+
+// Sample kernel for anti-aliasing with the row kernel of the frame's number type, which
+// finds the complex values of the samples just like every other renderer.
+template <typename Number>
+SampleKernel kernelSamples(const Viewport* viewport, int width, int height, int maxI,
+                           bool interiorChecks, RowKernel<Number> rowKernel) {
+    Complex<Number> upperLeft;
+    Complex<Number> lowerRight;
+    viewportAnchors(viewport, &upperLeft, &lowerRight);
+    return [=](const double* xs, const double* ys, int count, int* loops) {
+        Number real[maxSampleBatch];
+        Number imag[maxSampleBatch];
+        for (int i = 0; i < count; ++i) {
+            real[i] = pixelCoordinate(upperLeft.real, lowerRight.real, xs[i], width);
+            imag[i] = pixelCoordinate(upperLeft.imag, lowerRight.imag, ys[i], height);
+        }
+        rowKernel(real, imag, count, maxI, interiorChecks, loops, nullptr);
+    };
+}
+
+
+void antialiasFrame(ThreadPool* pool, const Viewport* viewport, int width, int height,
+                    int maxI, bool interiorChecks, const RowKernels* rowKernels,
+                    Precision precision, bool seriesApproximation,
+                    const Antialiasing* settings, const std::vector<int>& iterations,
+                    const ColorTable* colors, FrameBuffer* frameBuffer, FrameStats* stats,
+                    const std::atomic<bool>* cancel) {
+    if (settings->maxSamples <= 1) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    SampleKernel sample;
+    DeepFrame frame;
+    switch (precision) {
+        case PrecisionFloat:
+            sample = kernelSamples(viewport, width, height, maxI, interiorChecks,
+                                   rowKernels->floatKernel);
+            break;
+        case PrecisionDouble:
+            sample = kernelSamples(viewport, width, height, maxI, interiorChecks,
+                                   rowKernels->doubleKernel);
+            break;
+        case PrecisionDoubleDouble:
+            sample = kernelSamples(viewport, width, height, maxI, interiorChecks,
+                                   rowKernels->doubleDoubleKernel);
+            break;
+        case PrecisionQuadDouble:
+            sample = kernelSamples(viewport, width, height, maxI, interiorChecks,
+                                   rowKernels->quadDoubleKernel);
+            break;
+        case PrecisionPerturbation:
+            // the reference orbit of the frame is gone by now, but it is cheap next to
+            // the samples
+            prepareDeepFrame(viewport, width, maxI, seriesApproximation, &frame);
+            sample = [&](const double* xs, const double* ys, int count, int* loops) {
+                for (int i = 0; i < count; ++i) {
+                    loops[i] = perturbedLoops(frame, xs[i], ys[i], width, height, maxI);
+                }
+            };
+            break;
+    }
+
+    AntialiasStats antialiasStats;
+    antialias(pool, iterations, width, height, colors, settings, sample, frameBuffer,
+              &antialiasStats, cancel);
+    stats->antialiased = true;
+    stats->antialiasedPixels = antialiasStats.refinedPixels;
+    stats->antialiasSamples = antialiasStats.samples;
+    stats->antialiasMs = millisecondsSince(start);
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <tuple>
+#include <vector>
+#include "Kernel.hpp"
+#include "Viewport.hpp"
+#include "Precision.hpp"
+#include "ThreadPool.hpp"
+#include "FrameBuffer.hpp"
+#include "Reprojection.hpp"
+#include "Palette.hpp"
+#include "Trace.hpp"
+#include "TileCache.hpp"
+#include "Antialias.hpp"
+
+
+// Statistics of the last frame for the debug text.
+struct FrameStats {
+    // iterations skipped by series approximation
+    int skipped = 0;
+    // pixels iterated and pixels filled in by subdivision, only set when it is used
+    bool subdivided = false;
+    long computedPixels = 0;
+    long filledPixels = 0;
+    // pixels reused from the last frame, only set when reprojection is used
+    bool reprojected = false;
+    long reusedPixels = 0;
+    // pixel step of the pass shown when rendering progressively, 1 at full resolution
+    int step = 1;
+    // pixels copied from their mirror image across the real axis instead of iterated
+    long mirroredPixels = 0;
+    // pixels continued from the last frame after max loops changed on the same view
+    bool continued = false;
+    long continuedPixels = 0;
+    // tiles of the frame found in the tile cache and tiles iterated for it, only set
+    // when the frame is put together from the cache
+    bool cached = false;
+    long cachedTiles = 0;
+    long computedTiles = 0;
+    // pixels refined by anti-aliasing, the extra samples they took and how long it took,
+    // only set when it is on
+    bool antialiased = false;
+    long antialiasedPixels = 0;
+    long antialiasSamples = 0;
+    double antialiasMs = 0;
+
+    // milliseconds spent computing the loops and coloring them, all passes so far
+    // together, and the loops of all pixels, inside the set counted as max loops
+    double computeMs = 0;
+    double colorizeMs = 0;
+    long long loops = 0;
+    // seconds every worker of the pool was busy with the frame so far
+    std::vector<double> workerBusy;
+    // when the frame started and how busy the workers were by then
+    std::chrono::steady_clock::time_point start;
+    std::vector<double> busyAtStart;
+};
+
+
+// How much longer the busiest worker worked on the frame than the average one, 1 if the
+// work was spread perfectly.
+double loadImbalance(const FrameStats* stats);
+
+
+// Record the frame that was rendered on the lane from start to end into the trace, with
+// its timing, loops and how busy and idle every worker was.
+void traceFrame(Trace* trace, int lane, double start, double end, const FrameStats* stats);
+
+
+// What the iterations of the last frame belong to, so the next frame of the same view
+// doesn't have to start from scratch: with the same max loops it only has to be colored
+// again, e.g. with another palette, and with other max loops the pixels that were still
+// running continue from where their orbits stopped. Orbits are only kept for frames
+// rendered progressively without perturbation or subdivision.
+struct LastFrame {
+    // false while the iterations are incomplete, or only close because pixels of the
+    // frame before were reused
+    bool valid = false;
+    Viewport viewport;
+    // number type of the orbits, only its vector is allocated
+    Precision precision = PrecisionDouble;
+    int maxI = 0;
+    bool orbitsKept = false;
+    std::tuple<std::vector<Orbit<float>>, std::vector<Orbit<double>>,
+               std::vector<Orbit<DoubleDouble>>, std::vector<Orbit<QuadDouble>>> orbits;
+};
+
+
+// Render the amount of loops of every pixel into iterations, then color the frame buffer
+// from them with the color table. With subdivision, uniform areas are filled in instead
+// of iterated. With a reprojection, pixels of the last frame are reused where possible;
+// it may be nullptr to render every pixel from scratch.
+void divideAndConquer(ThreadPool* pool, const Viewport* viewport, int width, int height,
+                      int maxI, bool interiorChecks, const RowKernels* rowKernels,
+                      Precision precision, bool seriesApproximation, bool subdivision,
+                      Reprojection* reprojection, std::vector<int>* iterations,
+                      LastFrame* last, const ColorTable* colors, FrameBuffer* frameBuffer,
+                      FrameStats* stats);
+
+
+// Render the frame from coarse to fine into the frame buffer, calling passDone(step)
+// after every pass. If the last frame showed the same view, it is only continued or
+// colored again instead. Returns early once cancel is set.
+void renderProgressive(ThreadPool* pool, const Viewport* viewport, int width, int height,
+                       int maxI, bool interiorChecks, const RowKernels* rowKernels,
+                       Precision precision, bool seriesApproximation, bool subdivision,
+                       std::vector<int>* iterations, LastFrame* last,
+                       const ColorTable* colors, FrameBuffer* frameBuffer,
+                       FrameStats* stats, const std::atomic<bool>& cancel,
+                       const std::function<void(int)>& passDone);
+
+
+// Put the frame together from the tiles of the cache instead, iterating only the tiles
+// that are missing and storing them for the next frames. The frame is sampled on the
+// grid of the quadtree level whose spacing is closest to its pixels, every pixel takes
+// the loops of the sample closest to it, so it is at most 0.71 pixels off. Returns false
+// without rendering anything if the frame is too deep for the cache, needs more tiles
+// than it holds or isn't of the Mandelbrot set, which is the only fractal the tiles are
+// keyed for. Stops early once cancel is set, unless it is nullptr.
+bool renderCached(ThreadPool* pool, TileCache* cache, const Viewport* viewport, int width,
+                  int height, int maxI, bool interiorChecks, const RowKernels* rowKernels,
+                  std::vector<int>* iterations, LastFrame* last, const ColorTable* colors,
+                  FrameBuffer* frameBuffer, FrameStats* stats,
+                  const std::atomic<bool>* cancel);
+
+
+// Refine the pixels of the rendered frame that aren't uniform with extra samples in the
+// frame's number type, see antialias(). Does nothing if anti-aliasing is off. Stops early
+// once cancel is set, unless it is nullptr.
+void antialiasFrame(ThreadPool* pool, const Viewport* viewport, int width, int height,
+                    int maxI, bool interiorChecks, const RowKernels* rowKernels,
+                    Precision precision, bool seriesApproximation,
+                    const Antialiasing* settings, const std::vector<int>& iterations,
+                    const ColorTable* colors, FrameBuffer* frameBuffer, FrameStats* stats,
+                    const std::atomic<bool>* cancel);
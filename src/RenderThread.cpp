@@ -0,0 +1,68 @@
+#include "RenderThread.hpp"
+#include <utility>
+
+
+RenderThread::RenderThread() : thread(&RenderThread::threadLoop, this) {}
+
+
+RenderThread::~RenderThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pending = nullptr;
+        cancelFlag = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+
+// Replace whatever was submitted before and tell the running job to stop.
+void RenderThread::submit(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::move(job);
+        if (busy) {
+            cancelFlag = true;
+        }
+    }
+    wake.notify_one();
+}
+
+
+void RenderThread::cancel() {
+    std::unique_lock<std::mutex> lock(mutex);
+    pending = nullptr;
+    if (busy) {
+        cancelFlag = true;
+    }
+    idle.wait(lock, [this] { return !busy; });
+}
+
+
+// Sleep until a job is submitted and run it. The cancel flag is only reset while the
+// mutex is held, so a submit() can't get lost between taking a job and starting it.
+void RenderThread::threadLoop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || pending; });
+            if (stopping) {
+                return;
+            }
+            job = std::move(pending);
+            pending = nullptr;
+            cancelFlag = false;
+            busy = true;
+        }
+
+        job(cancelFlag);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = false;
+        }
+        idle.notify_all();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+// A thread of its own that renders one frame at a time in the background, so the event
+// loop stays responsive while a frame takes long. Submitting a new frame cancels the one
+// in progress: its job sees the cancel flag go up and is expected to return soon after,
+// then the newest submitted job runs. Jobs submitted in between are dropped.
+class RenderThread {
+public:
+    // Renders one frame. It has to check cancel regularly and give up once it is set.
+    using Job = std::function<void(const std::atomic<bool>& cancel)>;
+
+    RenderThread();
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // Cancel the frame in progress, if any, and render job next. Returns right away.
+    void submit(Job job);
+
+    // Cancel the frame in progress and drop the submitted one, then wait until the
+    // thread is idle. Needed before anybody else may use what the jobs use.
+    void cancel();
+
+private:
+    void threadLoop();
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    Job pending;
+    bool busy = false;
+    bool stopping = false;
+    std::atomic<bool> cancelFlag{false};
+    // started last, once everything above is set up
+    std::thread thread;
+};
@@ -0,0 +1,62 @@
+#include "Reprojection.hpp"
+#include <math.h>
+
+
+// Reuse the samples of the last frame along one axis. A sample at position p of the last
+// frame is at shift + p * ratio in pixels of the new one. Each new column takes the
+// closest sample within tolerance, all others are sampled at their own pixel.
+static void reprojectAxis(const AxisSamples &last, double shift, double ratio, int size,
+                          double tolerance, AxisSamples *next) {
+    next->position.resize(size);
+    next->source.assign(size, -1);
+    for (int x = 0; x < size; ++x) {
+        next->position[x] = x;
+    }
+
+    const int lastSize = static_cast<int>(last.position.size());
+    for (int i = 0; i < lastSize; ++i) {
+        double position = shift + last.position[i] * ratio;
+        double nearest = floor(position + 0.5);
+        if (nearest < 0 || nearest >= size) {
+            continue;
+        }
+        int x = static_cast<int>(nearest);
+        double error = fabs(position - x);
+        if (error <= tolerance
+            && (next->source[x] < 0 || error < fabs(next->position[x] - x))) {
+            next->position[x] = position;
+            next->source[x] = i;
+        }
+    }
+}
+
+
+// Where the samples of the last frame are in pixels of the new one. A sample at position
+// p of a frame is at upperLeft + p / size * span, and upperLeft = center - span / 2, so
+// the last frame's samples are shifted by the distance of the centers and scaled by the
+// ratio of the spans, both in pixels of the new frame.
+void reproject(const Reprojection *last, const Viewport *viewport, int width, int height,
+               int maxI, AxisSamples *columns, AxisSamples *rows) {
+    AxisSamples none;
+    if (!last->valid || last->maxI != maxI
+        || static_cast<int>(last->columns.position.size()) != width
+        || static_cast<int>(last->rows.position.size()) != height) {
+        reprojectAxis(none, 0, 1, width, last->tolerance, columns);
+        reprojectAxis(none, 0, 1, height, last->tolerance, rows);
+        return;
+    }
+
+    mp_bitcnt_t precision = viewport->center.real.get_prec();
+    mpf_class distance(0, precision);
+    mpf_class ratio(0, precision);
+
+    distance = (last->viewport.center.real - viewport->center.real) / viewport->spanReal;
+    ratio = last->viewport.spanReal / viewport->spanReal;
+    reprojectAxis(last->columns, width * (distance.get_d() + (1 - ratio.get_d()) / 2),
+                  ratio.get_d(), width, last->tolerance, columns);
+
+    distance = (last->viewport.center.imag - viewport->center.imag) / viewport->spanImag;
+    ratio = last->viewport.spanImag / viewport->spanImag;
+    reprojectAxis(last->rows, height * (distance.get_d() + (1 - ratio.get_d()) / 2),
+                  ratio.get_d(), height, last->tolerance, rows);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include "Viewport.hpp"
+
+
+// Where the samples of the columns (or rows) of a frame are and where they come from.
+// The frame is always sampled on a grid: every pixel of column x is iterated at the real
+// part of position[x] and every pixel of row y at the imaginary part of its row's
+// position. A column that isn't reused is sampled at its own pixel, position[x] == x.
+struct AxisSamples {
+    // in pixels of the frame, so x = 0 is the left edge and x = width the right edge
+    std::vector<double> position;
+    // column (or row) of the last frame whose samples are reused, -1 if there is none
+    std::vector<int> source;
+};
+
+
+// Everything kept of the last frame to reuse its pixels for the next one. Zooming only
+// shrinks and moves the viewport, so every column of the last frame lands on a single
+// real part of the new one and every row on a single imaginary part. A column whose
+// samples end up at most tolerance pixels away from a new column is reused for it with
+// all of its rows, and so is a row. Pixels where both are reused keep the amount of
+// loops of the last frame, all others are iterated. The positions are tracked exactly
+// from frame to frame, so reused samples can never drift further than tolerance.
+struct Reprojection {
+    // at most 0.5 pixels, 0 only reuses samples that land exactly on a new pixel
+    double tolerance = 0.5;
+    // false until there is a last frame to reuse
+    bool valid = false;
+    Viewport viewport;
+    int maxI = 0;
+    AxisSamples columns;
+    AxisSamples rows;
+    std::vector<int> loops;
+};
+
+
+// Find the columns and rows of the last frame that can be reused for a width x height
+// frame of the viewport, and where the samples of the new frame are. If there is no
+// last frame to reuse, or it was rendered with different max loops, nothing is reused.
+void reproject(const Reprojection *last, const Viewport *viewport, int width, int height,
+               int maxI, AxisSamples *columns, AxisSamples *rows);
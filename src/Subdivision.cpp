@@ -0,0 +1,137 @@
+#include "Subdivision.hpp"
+#include <algorithm>
+
+
+// Compute the pixels of row y from x0 inclusive to x1 exclusive.
+static long computeRow(const SpanKernel &span, int width, int y, int x0, int x1,
+                       int *loops) {
+    int* row = loops + static_cast<size_t>(y) * width;
+    for (int x = x0; x < x1; x += maxSpanLength) {
+        span(x, y, std::min(maxSpanLength, x1 - x), false, row + x);
+    }
+    return x1 - x0;
+}
+
+
+// Compute the pixels of column x from y0 inclusive to y1 exclusive. They aren't next to
+// each other in memory, so they go through a buffer.
+static long computeColumn(const SpanKernel &span, int width, int x, int y0, int y1,
+                          int *loops) {
+    int column[maxSpanLength];
+    for (int y = y0; y < y1; y += maxSpanLength) {
+        int count = std::min(maxSpanLength, y1 - y);
+        span(x, y, count, true, column);
+        for (int i = 0; i < count; ++i) {
+            loops[static_cast<size_t>(y + i) * width + x] = column[i];
+        }
+    }
+    return y1 - y0;
+}
+
+
+// Whether every border pixel of the rectangle has the same amount of loops, which is
+// then stored in value.
+static bool uniformBorder(const Tile &rect, int width, const int *loops, int *value) {
+    const int* top = loops + static_cast<size_t>(rect.y0) * width;
+    const int* bottom = loops + static_cast<size_t>(rect.y1 - 1) * width;
+    (*value) = top[rect.x0];
+    for (int x = rect.x0; x < rect.x1; ++x) {
+        if (top[x] != *value || bottom[x] != *value) {
+            return false;
+        }
+    }
+    for (int y = rect.y0 + 1; y < rect.y1 - 1; ++y) {
+        const int* row = loops + static_cast<size_t>(y) * width;
+        if (row[rect.x0] != *value || row[rect.x1 - 1] != *value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Handle one rectangle whose border is already computed: fill its inside if the border
+// is uniform, compute the inside completely if the rectangle is too small to split, or
+// compute the middle row and column and append the four parts to next. The parts share
+// the middle row and column as their border, so every task only ever writes to the
+// inside of its own rectangle and tasks of the same level never touch the same pixel.
+static void subdivide(const Tile &rect, int width, const SpanKernel &span, int *loops,
+                      std::vector<Tile> *next, SubdivisionStats *stats) {
+    const int insideX0 = rect.x0 + 1;
+    const int insideX1 = rect.x1 - 1;
+    const int insideY0 = rect.y0 + 1;
+    const int insideY1 = rect.y1 - 1;
+    if (insideX0 >= insideX1 || insideY0 >= insideY1) {
+        return;
+    }
+
+    int value;
+    if (uniformBorder(rect, width, loops, &value)) {
+        for (int y = insideY0; y < insideY1; ++y) {
+            int* row = loops + static_cast<size_t>(y) * width;
+            std::fill(row + insideX0, row + insideX1, value);
+        }
+        stats->filled += static_cast<long>(insideX1 - insideX0) * (insideY1 - insideY0);
+        return;
+    }
+
+    if (rect.x1 - rect.x0 < minSubdivisionSize || rect.y1 - rect.y0 < minSubdivisionSize) {
+        for (int y = insideY0; y < insideY1; ++y) {
+            stats->computed += computeRow(span, width, y, insideX0, insideX1, loops);
+        }
+        return;
+    }
+
+    const int middleX = (rect.x0 + rect.x1 - 1) / 2;
+    const int middleY = (rect.y0 + rect.y1 - 1) / 2;
+    stats->computed += computeRow(span, width, middleY, insideX0, insideX1, loops);
+    stats->computed += computeColumn(span, width, middleX, insideY0, middleY, loops);
+    stats->computed += computeColumn(span, width, middleX, middleY + 1, insideY1, loops);
+    next->push_back({rect.x0, rect.y0, middleX + 1, middleY + 1});
+    next->push_back({middleX, rect.y0, rect.x1, middleY + 1});
+    next->push_back({rect.x0, middleY, middleX + 1, rect.y1});
+    next->push_back({middleX, middleY, rect.x1, rect.y1});
+}
+
+
+// Start with the border of the whole frame, then work off the rectangles level by level.
+// The pool waits for every level to finish, so the borders a level reads are complete.
+void computeSubdivided(ThreadPool *pool, int width, int height, const SpanKernel &span,
+                       std::vector<int> *loops, SubdivisionStats *stats,
+                       const std::atomic<bool> *cancel) {
+    loops->resize(static_cast<size_t>(width) * height);
+    int* data = loops->data();
+    stats->computed = 0;
+    stats->filled = 0;
+
+    stats->computed += computeRow(span, width, 0, 0, width, data);
+    if (height > 1) {
+        stats->computed += computeRow(span, width, height - 1, 0, width, data);
+    }
+    stats->computed += computeColumn(span, width, 0, 1, height - 1, data);
+    if (width > 1) {
+        stats->computed += computeColumn(span, width, width - 1, 1, height - 1, data);
+    }
+
+    std::vector<Tile> level = {{0, 0, width, height}};
+    std::vector<std::vector<Tile>> next(pool->size());
+    std::vector<SubdivisionStats> workerStats(pool->size());
+    while (!level.empty()) {
+        for (int worker = 0; worker < pool->size(); ++worker) {
+            next[worker].clear();
+            workerStats[worker] = {0, 0};
+        }
+        pool->run(static_cast<int>(level.size()), [&](int index, int worker) {
+            if (cancel != nullptr && *cancel) {
+                return;
+            }
+            subdivide(level[index], width, span, data, &next[worker], &workerStats[worker]);
+        });
+        level.clear();
+        for (int worker = 0; worker < pool->size(); ++worker) {
+            level.insert(level.end(), next[worker].begin(), next[worker].end());
+            stats->computed += workerStats[worker].computed;
+            stats->filled += workerStats[worker].filled;
+        }
+    }
+}
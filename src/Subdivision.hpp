@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "ThreadPool.hpp"
+
+
+// Writes the amount of loops of count pixels starting at (x, y) into loops, going right
+// along the row or, if vertical, down along the column. count is at most maxSpanLength.
+// Whatever renders the frame (a row kernel or perturbation) is hidden behind this.
+using SpanKernel = std::function<void(int x, int y, int count, bool vertical, int* loops)>;
+
+
+// Longest span handed to a span kernel at once, so it can keep its buffers on the stack.
+const int maxSpanLength = 64;
+
+
+// Rectangles smaller than this in either direction are computed pixel by pixel instead
+// of being split any further.
+const int minSubdivisionSize = 16;
+
+
+// How many pixels of a frame were iterated and how many were filled in from the border
+// of their rectangle.
+struct SubdivisionStats {
+    long computed;
+    long filled;
+};
+
+
+// Mariani-Silver rendering: compute only the border of a rectangle, and if every border
+// pixel has the same amount of loops, fill the inside with it without iterating.
+// Otherwise the rectangle is split into four along a middle row and column and each part
+// is handled the same way. The parts of one level of splitting are independent, so they
+// are handed to the pool as parallel tasks. Writes the amount of loops of every pixel
+// into loops, which is resized to width * height. Once cancel is set, no more rectangles
+// are worked on and loops is left incomplete; it may be nullptr if that can't happen.
+void computeSubdivided(ThreadPool *pool, int width, int height, const SpanKernel &span,
+                       std::vector<int> *loops, SubdivisionStats *stats,
+                       const std::atomic<bool> *cancel);
@@ -0,0 +1,152 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <chrono>
+
+
+// Split a width x height frame into tiles of tileSize x tileSize, row by row.
+std::vector<Tile> makeTiles(int width, int height) {
+    std::vector<Tile> tiles;
+    for (int y = 0; y < height; y += tileSize) {
+        for (int x = 0; x < width; x += tileSize) {
+            tiles.push_back({x, y, std::min(x + tileSize, width),
+                             std::min(y + tileSize, height)});
+        }
+    }
+    return tiles;
+}
+
+
+// Start threadCount workers, or one per CPU core if threadCount <= 0.
+ThreadPool::ThreadPool(int threadCount) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        queues.emplace_back(new Queue());
+    }
+    busy.assign(threadCount, 0);
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+
+int ThreadPool::size() const {
+    return static_cast<int>(threads.size());
+}
+
+
+std::vector<double> ThreadPool::busySeconds() const {
+    return busy;
+}
+
+
+void ThreadPool::setTrace(Trace* trace) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->trace = trace;
+}
+
+
+// Deal the tasks out in contiguous blocks, so neighbouring tiles end up on the same
+// worker until someone steals them, then wake everybody up and wait.
+void ThreadPool::run(int taskCount, const std::function<void(int, int)>& task,
+                     const char* name) {
+    const int threadCount = size();
+    for (int worker = 0; worker < threadCount; ++worker) {
+        int begin = static_cast<int>(static_cast<long long>(taskCount) * worker / threadCount);
+        int end = static_cast<int>(static_cast<long long>(taskCount) * (worker + 1) / threadCount);
+        std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+        for (int i = begin; i < end; ++i) {
+            queues[worker]->tasks.push_back(i);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    job = &task;
+    jobName = name;
+    activeWorkers = threadCount;
+    generation++;
+    wake.notify_all();
+    finished.wait(lock, [this] { return activeWorkers == 0; });
+    job = nullptr;
+}
+
+
+// Take the next task from the back of the own deque, or steal one from the front of
+// another worker's deque. Returns false once every deque is empty.
+bool ThreadPool::nextTask(int worker, int* task) {
+    {
+        Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            (*task) = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    const int threadCount = size();
+    for (int i = 1; i < threadCount; ++i) {
+        Queue& victim = *queues[(worker + i) % threadCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            (*task) = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Sleep until run() hands out new tasks, work them off and report back.
+void ThreadPool::workerLoop(int worker) {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        const std::function<void(int, int)>* currentJob;
+        const char* currentName;
+        Trace* currentTrace;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+            currentJob = job;
+            currentName = jobName;
+            currentTrace = trace;
+        }
+
+        // no new tasks are added during a generation, so once all deques are empty
+        // this worker is done
+        auto start = std::chrono::steady_clock::now();
+        double traceStart = currentTrace ? currentTrace->now() : 0;
+        int task;
+        while (nextTask(worker, &task)) {
+            (*currentJob)(task, worker);
+        }
+        busy[worker] += std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                      - start).count();
+        if (currentTrace) {
+            currentTrace->event(currentName, traceWorkerLane + worker, traceStart,
+                                currentTrace->now());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeWorkers == 0) {
+            finished.notify_one();
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Trace.hpp"
+
+
+// A rectangle of pixels from (x0, y0) inclusive to (x1, y1) exclusive.
+struct Tile {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+
+// Side length of the square tiles a frame is split into.
+const int tileSize = 32;
+
+
+// Split a width x height frame into tiles of tileSize x tileSize, row by row. Tiles at
+// the right and bottom border are cut off at the frame size.
+std::vector<Tile> makeTiles(int width, int height);
+
+
+// Long-lived worker threads that are created once and then run all frames. Every call of
+// run() hands out a batch of tasks: each worker gets its own deque with a contiguous
+// share of them, works it off from the back and, once it is empty, steals from the front
+// of the other workers' deques. That way workers whose tiles happen to be cheap help out
+// the ones stuck in the black interior instead of idling.
+class ThreadPool {
+public:
+    // Start threadCount workers, or one per CPU core if threadCount <= 0.
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const;
+
+    // Call task(index, worker) for every index in [0, taskCount) and return once all of
+    // them are done. worker is the id of the worker running the task, in [0, size()).
+    // With a trace, every worker's share of the tasks shows up in it as name.
+    void run(int taskCount, const std::function<void(int, int)>& task,
+             const char* name = "compute");
+
+    // Record the tasks of every worker into the trace from now on, nullptr to stop. The
+    // trace has to outlive the pool.
+    void setTrace(Trace* trace);
+
+    // Seconds every worker spent working off tasks since the pool was started, by worker
+    // id. Only up to date between calls of run().
+    std::vector<double> busySeconds() const;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    void workerLoop(int worker);
+    bool nextTask(int worker, int* task);
+
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Queue>> queues;
+    // every worker only adds to its own, before reporting back to run()
+    std::vector<double> busy;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(int, int)>* job = nullptr;
+    const char* jobName = nullptr;
+    Trace* trace = nullptr;
+    uint64_t generation = 0;
+    int activeWorkers = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,154 @@
+#include "TileCache.hpp"
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+// Marks a slot that holds a tile, and changes whenever the layout of a slot does, so
+// tiles of an older layout are dropped instead of misread.
+const uint64_t slotMagic = 0x3130454c49544d4dULL;
+
+
+// Header of a slot, padded to a cache line so the loops after it stay aligned. magic is
+// only written once the rest of the slot is, so a slot that was being written when the
+// program died is free again.
+struct alignas(64) TileCache::Slot {
+    uint64_t magic;
+    uint64_t lastUse;
+    TileKey key;
+};
+
+
+// Bytes of a slot with its loops.
+const size_t slotBytes = 64 + cacheTilePixels * sizeof(int);
+
+
+bool operator==(const TileKey& a, const TileKey& b) {
+    return a.level == b.level && a.maxI == b.maxI && a.x == b.x && a.y == b.y
+           && a.interiorChecks == b.interiorChecks;
+}
+
+
+size_t TileKeyHash::operator()(const TileKey& key) const {
+    uint64_t hash = static_cast<uint64_t>(key.x) * 0x9e3779b97f4a7c15ULL;
+    hash ^= static_cast<uint64_t>(key.y) + 0x632be59bd9b4e019ULL + (hash << 6) + (hash >> 2);
+    hash ^= (static_cast<uint64_t>(key.level) << 32 | static_cast<uint32_t>(key.maxI))
+            + (hash << 6) + (hash >> 2);
+    return static_cast<size_t>(hash ^ static_cast<uint64_t>(key.interiorChecks));
+}
+
+
+TileCache::TileCache(const std::string& path, size_t maxBytes)
+    : slots(maxBytes / slotBytes) {
+    static_assert(sizeof(Slot) == 64, "the loops of a slot have to start at byte 64");
+    if (slots == 0) {
+        std::cout << "Cache " << path << " needs room for at least one tile.\n";
+        exit(1);
+    }
+    file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (file < 0) {
+        std::cout << "Cache " << path << " could not be opened.\n";
+        exit(1);
+    }
+    // a second process would evict tiles the first one still reads
+    if (flock(file, LOCK_EX | LOCK_NB) != 0) {
+        std::cout << "Cache " << path << " is used by another process.\n";
+        exit(1);
+    }
+    // new slots read as zeros, so they are free
+    const size_t bytes = slots * slotBytes;
+    if (ftruncate(file, static_cast<off_t>(bytes)) != 0) {
+        std::cout << "Cache " << path << " could not be resized.\n";
+        exit(1);
+    }
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (memory == MAP_FAILED) {
+        std::cout << "Cache " << path << " could not be mapped.\n";
+        exit(1);
+    }
+    mapped = static_cast<uint8_t*>(memory);
+
+    for (size_t slot = 0; slot < slots; ++slot) {
+        const Slot* header = slotAt(slot);
+        if (header->magic != slotMagic) {
+            freeSlots.push_back(slot);
+            continue;
+        }
+        index[header->key] = slot;
+        uses.insert({header->lastUse, slot});
+        clock = std::max(clock, header->lastUse);
+    }
+    // hand out the free slots from the start of the file
+    std::reverse(freeSlots.begin(), freeSlots.end());
+}
+
+
+TileCache::~TileCache() {
+    munmap(mapped, slots * slotBytes);
+    close(file);
+}
+
+
+TileCache::Slot* TileCache::slotAt(size_t slot) const {
+    return reinterpret_cast<Slot*>(mapped + slot * slotBytes);
+}
+
+
+// Make the tile in the slot the one used last, also for the next sessions.
+void TileCache::use(size_t slot) {
+    Slot* header = slotAt(slot);
+    uses.erase({header->lastUse, slot});
+    header->lastUse = ++clock;
+    uses.insert({header->lastUse, slot});
+}
+
+
+const int* TileCache::find(const TileKey& key) {
+    auto found = index.find(key);
+    if (found == index.end()) {
+        return nullptr;
+    }
+    use(found->second);
+    return reinterpret_cast<const int*>(slotAt(found->second) + 1);
+}
+
+
+const int* TileCache::store(const TileKey& key, const int* loops) {
+    size_t slot;
+    auto found = index.find(key);
+    if (found != index.end()) {
+        slot = found->second;
+    } else if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = uses.begin()->second;
+        uses.erase(uses.begin());
+        index.erase(slotAt(slot)->key);
+    }
+
+    Slot* header = slotAt(slot);
+    header->magic = 0;
+    int* slotLoops = reinterpret_cast<int*>(header + 1);
+    std::memcpy(slotLoops, loops, cacheTilePixels * sizeof(int));
+    header->key = key;
+    index[key] = slot;
+    use(slot);
+    header->magic = slotMagic;
+    return slotLoops;
+}
+
+
+size_t TileCache::capacity() const {
+    return slots;
+}
+
+
+size_t TileCache::size() const {
+    return index.size();
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+// Side length of the square tiles of the cache, in samples.
+const int cacheTileSize = 64;
+
+
+// Loops of a tile.
+const int cacheTilePixels = cacheTileSize * cacheTileSize;
+
+
+// Which tile of the quadtree, like a map tile. On level L the complex plane is sampled on
+// a grid with 2^-L between neighbouring samples, with a sample right at 0. Tile (x, y)
+// holds the samples x * 64 to x * 64 + 63 steps right of 0 and y * 64 to y * 64 + 63
+// steps below it. Its loops also depend on max loops and the interior checks.
+struct TileKey {
+    int32_t level;
+    int32_t maxI;
+    int64_t x;
+    int64_t y;
+    int32_t interiorChecks;
+};
+
+
+bool operator==(const TileKey& a, const TileKey& b);
+
+
+struct TileKeyHash {
+    size_t operator()(const TileKey& key) const;
+};
+
+
+// Tiles of loops kept in a file across sessions. The file is a row of fixed-size slots,
+// each a header with the key of its tile and when the tile was used last, followed by
+// its loops. It is mapped into memory as a whole, so cached loops are read right where
+// they lie and the system pages them in and out. Once every slot is taken, the tile used
+// longest ago makes room for the next one. Only one process can open a cache file at a
+// time, and only one thread at a time may use it.
+class TileCache {
+public:
+    // Open the cache file at path, or create it, with as many slots as fit into maxBytes.
+    // A file with another amount of slots is cut or grown to it, dropping the tiles past
+    // the new end. Exits with an error if the file can't be used.
+    TileCache(const std::string& path, size_t maxBytes);
+    // Unmaps the file, which leaves writing it back to the system.
+    ~TileCache();
+
+    TileCache(const TileCache&) = delete;
+    TileCache& operator=(const TileCache&) = delete;
+
+    // The cacheTileSize x cacheTileSize loops of the tile row by row, or nullptr if it
+    // isn't cached. Finding a tile counts as using it, and its loops stay where they are
+    // until capacity() other tiles were used after it.
+    const int* find(const TileKey& key);
+
+    // Copy the loops of a tile into the cache and return where they are now, in the slot
+    // of the tile used longest ago if there is no free one.
+    const int* store(const TileKey& key, const int* loops);
+
+    // How many tiles the cache can hold at most and how many it holds.
+    size_t capacity() const;
+    size_t size() const;
+
+private:
+    struct Slot;
+
+    Slot* slotAt(size_t slot) const;
+    void use(size_t slot);
+
+    int file = -1;
+    uint8_t* mapped = nullptr;
+    size_t slots = 0;
+    // last use of the tile used last, counting up over all sessions
+    uint64_t clock = 0;
+    std::unordered_map<TileKey, size_t, TileKeyHash> index;
+    // last use and slot of every tile, the first one is the next to make room
+    std::set<std::pair<uint64_t, size_t>> uses;
+    std::vector<size_t> freeSlots;
+};
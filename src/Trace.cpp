@@ -0,0 +1,58 @@
+#include "Trace.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+
+Trace::Trace(const std::string& path)
+    : path(path), started(std::chrono::steady_clock::now()) {
+    // find out right away instead of after the whole run
+    std::ofstream file(path);
+    if (!file) {
+        std::cout << "Trace file " << path << " could not be written.\n";
+        exit(1);
+    }
+}
+
+
+// Complete events ("X") with their start and duration in microseconds, and the names of
+// the lanes as thread name metadata ("M").
+Trace::~Trace() {
+    std::ofstream file(path);
+    file << std::fixed << std::setprecision(3) << "{\"traceEvents\": [\n";
+    for (int lane = 0; lane < lanes; ++lane) {
+        std::string name = lane == traceMainLane     ? "main"
+                           : lane == traceRenderLane ? "render"
+                           : "worker " + std::to_string(lane - traceWorkerLane);
+        file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << lane
+             << ", \"args\": {\"name\": \"" << name << "\"}},\n";
+    }
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event& event = events[i];
+        file << "{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+             << event.lane << ", \"ts\": " << event.start << ", \"dur\": "
+             << event.end - event.start << ", \"args\": {";
+        for (size_t arg = 0; arg < event.args.size(); ++arg) {
+            file << (arg > 0 ? ", " : "") << "\"" << event.args[arg].first
+                 << "\": " << event.args[arg].second;
+        }
+        file << "}}" << (i + 1 < events.size() ? "," : "") << "\n";
+    }
+    file << "]}\n";
+}
+
+
+double Trace::now() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now()
+                                                     - started).count();
+}
+
+
+void Trace::event(const char* name, int lane, double start, double end,
+                  std::vector<std::pair<std::string, double>> args) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back({name, lane, start, end, std::move(args)});
+    lanes = std::max(lanes, lane + 1);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Lanes of the trace, one per thread. Worker w of the thread pool is on lane
+// traceWorkerLane + w.
+const int traceMainLane = 0;
+const int traceRenderLane = 1;
+const int traceWorkerLane = 2;
+
+
+// Timeline of what every thread did when, written as Chrome trace events that
+// chrome://tracing and Perfetto can show. Events are kept in memory, a few hundred per
+// frame, and only written to the file when the trace goes away.
+class Trace {
+public:
+    // Exits with an error if the file can't be written.
+    explicit Trace(const std::string& path);
+    ~Trace();
+
+    Trace(const Trace&) = delete;
+    Trace& operator=(const Trace&) = delete;
+
+    // Microseconds since the trace was started.
+    double now() const;
+
+    // Record that the lane was busy with name from start to end, both from now(). The
+    // args are shown along with the event. Can be called from any thread.
+    void event(const char* name, int lane, double start, double end,
+               std::vector<std::pair<std::string, double>> args = {});
+
+private:
+    struct Event {
+        const char* name;
+        int lane;
+        double start;
+        double end;
+        std::vector<std::pair<std::string, double>> args;
+    };
+
+    std::string path;
+    std::chrono::steady_clock::time_point started;
+    std::mutex mutex;
+    std::vector<Event> events;
+    int lanes = traceWorkerLane;
+};
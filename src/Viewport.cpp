@@ -0,0 +1,233 @@
+#include "Viewport.hpp"
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+
+// Bits of precision needed so neighbouring pixels of the viewport still have distinct
+// coordinates, with 64 bits of headroom on top.
+static mp_bitcnt_t neededPrecision(const Viewport *viewport, int width) {
+    long spacingExp = pixelSpacingExp(viewport, width);
+    return static_cast<mp_bitcnt_t>(64 + std::max(0L, -spacingExp));
+}
+
+
+// Raise the precision of the viewport when zooming deeper. mpf_set_prec keeps the value,
+// so this never loses what was already there.
+static void updatePrecision(Viewport *viewport, int width) {
+    mp_bitcnt_t precision = neededPrecision(viewport, width);
+    if (viewport->center.real.get_prec() < precision) {
+        viewport->center.real.set_prec(precision);
+        viewport->center.imag.set_prec(precision);
+        viewport->spanReal.set_prec(precision);
+        viewport->spanImag.set_prec(precision);
+    }
+}
+
+
+// Initialize the viewport from the upperLeft and lowerRight complex number anchors.
+void initViewport(Viewport *viewport, const Complex<double> *upperLeft,
+                  const Complex<double> *lowerRight) {
+    viewport->center.real = (mpf_class(upperLeft->real) + lowerRight->real) / 2;
+    viewport->center.imag = (mpf_class(upperLeft->imag) + lowerRight->imag) / 2;
+    viewport->spanReal = mpf_class(lowerRight->real) - upperLeft->real;
+    viewport->spanImag = mpf_class(lowerRight->imag) - upperLeft->imag;
+}
+
+
+// Initialize the viewport centered on center and spanReal wide. It takes at least the
+// precision the center was parsed with, so long coordinates aren't rounded.
+void initViewportCentered(Viewport *viewport, const BigComplex *center,
+                          const mpf_class &spanReal, int width, int height) {
+    mp_bitcnt_t precision = std::max(center->real.get_prec(), center->imag.get_prec());
+    viewport->center.real.set_prec(precision);
+    viewport->center.imag.set_prec(precision);
+    viewport->spanReal.set_prec(precision);
+    viewport->spanImag.set_prec(precision);
+    viewport->center.real = center->real;
+    viewport->center.imag = center->imag;
+    viewport->spanReal = spanReal;
+    viewport->spanImag = -spanReal * height / width;
+    updatePrecision(viewport, width);
+}
+
+
+// Parse a decimal number with as many bits of precision as its digits need, roughly
+// log2(10) = 3.33 bits per digit.
+mpf_class parseBig(const char *text) {
+    mp_bitcnt_t precision = 64 + static_cast<mp_bitcnt_t>(std::strlen(text) * 3.33);
+    // mpf_class doesn't like a leading +
+    if (text[0] == '+') {
+        text++;
+    }
+    return mpf_class(text, precision);
+}
+
+
+// Round a high precision number to one of the kernel number types. The extended
+// precision types take the double closest to the value as their first part and the
+// remainder for the next ones.
+template <>
+float bigToNumber<float>(const mpf_class &value) {
+    return static_cast<float>(value.get_d());
+}
+
+template <>
+double bigToNumber<double>(const mpf_class &value) {
+    return value.get_d();
+}
+
+template <>
+DoubleDouble bigToNumber<DoubleDouble>(const mpf_class &value) {
+    mpf_class rest(value, value.get_prec());
+    double hi = rest.get_d();
+    rest -= hi;
+    return DoubleDouble(hi, rest.get_d());
+}
+
+template <>
+QuadDouble bigToNumber<QuadDouble>(const mpf_class &value) {
+    mpf_class rest(value, value.get_prec());
+    QuadDouble number;
+    for (int i = 0; i < 4; ++i) {
+        number.part[i] = rest.get_d();
+        rest -= number.part[i];
+    }
+    return number;
+}
+
+
+// Round the viewport to the upperLeft and lowerRight anchors in the given number type.
+template <typename Number>
+void viewportAnchors(const Viewport *viewport, Complex<Number> *upperLeft,
+                     Complex<Number> *lowerRight) {
+    mp_bitcnt_t precision = viewport->center.real.get_prec();
+    mpf_class halfReal(viewport->spanReal / 2, precision);
+    mpf_class halfImag(viewport->spanImag / 2, precision);
+    initComplex(upperLeft,
+                bigToNumber<Number>(mpf_class(viewport->center.real - halfReal, precision)),
+                bigToNumber<Number>(mpf_class(viewport->center.imag - halfImag, precision)));
+    initComplex(lowerRight,
+                bigToNumber<Number>(mpf_class(viewport->center.real + halfReal, precision)),
+                bigToNumber<Number>(mpf_class(viewport->center.imag + halfImag, precision)));
+}
+
+template void viewportAnchors<float>(const Viewport*, Complex<float>*, Complex<float>*);
+template void viewportAnchors<double>(const Viewport*, Complex<double>*, Complex<double>*);
+template void viewportAnchors<DoubleDouble>(const Viewport*, Complex<DoubleDouble>*,
+                                            Complex<DoubleDouble>*);
+template void viewportAnchors<QuadDouble>(const Viewport*, Complex<QuadDouble>*,
+                                          Complex<QuadDouble>*);
+
+
+// Digits would not do, mpf_get_str rounds to the precision while the number can keep a
+// limb more than that.
+void writeBig(std::ostream& out, const mpf_class& value) {
+    const __mpf_struct* number = value.get_mpf_t();
+    out << value.get_prec() << " " << number->_mp_size << " " << number->_mp_exp
+        << std::hex;
+    for (int i = 0; i < std::abs(number->_mp_size); ++i) {
+        out << " " << number->_mp_d[i];
+    }
+    out << std::dec;
+}
+
+
+bool readBig(std::istream& in, mpf_class* value) {
+    mp_bitcnt_t precision;
+    int size;
+    mp_exp_t exponent;
+    if (!(in >> precision >> size >> exponent) || precision == 0) {
+        return false;
+    }
+    value->set_prec(precision);
+    __mpf_struct* number = value->get_mpf_t();
+    if (std::abs(size) > number->_mp_prec + 1) {
+        return false;
+    }
+    in >> std::hex;
+    for (int i = 0; i < std::abs(size); ++i) {
+        if (!(in >> number->_mp_d[i])) {
+            return false;
+        }
+    }
+    in >> std::dec;
+    number->_mp_size = size;
+    number->_mp_exp = exponent;
+    return true;
+}
+
+
+void writeViewport(std::ostream& out, const Viewport *viewport) {
+    const mpf_class* values[4] = {&viewport->center.real, &viewport->center.imag,
+                                  &viewport->spanReal, &viewport->spanImag};
+    for (const mpf_class* value : values) {
+        writeBig(out, *value);
+        out << "\n";
+    }
+}
+
+
+bool readViewport(std::istream& in, Viewport *viewport) {
+    mpf_class* values[4] = {&viewport->center.real, &viewport->center.imag,
+                            &viewport->spanReal, &viewport->spanImag};
+    for (mpf_class* value : values) {
+        if (!readBig(in, value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Whether two viewports show exactly the same part of the complex plane.
+bool sameViewport(const Viewport *a, const Viewport *b) {
+    return a->center.real == b->center.real && a->center.imag == b->center.imag
+           && a->spanReal == b->spanReal && a->spanImag == b->spanImag;
+}
+
+
+// Binary exponent of the distance between two pixels.
+long pixelSpacingExp(const Viewport *viewport, int width) {
+    long exponent;
+    mpf_class spacing = viewport->spanReal / width;
+    mpf_get_d_2exp(&exponent, spacing.get_mpf_t());
+    return exponent;
+}
+
+
+// Complex value of the pixel position (x, y), using the same ratio as the double path:
+// x = 0 is the left edge of the viewport and x = width the right edge.
+void pixelToComplex(const Viewport *viewport, double x, double y, int width, int height,
+                    BigComplex *position) {
+    mp_bitcnt_t precision = viewport->center.real.get_prec();
+    double ratioX = x / width - 0.5;
+    double ratioY = y / height - 0.5;
+    position->real.set_prec(precision);
+    position->imag.set_prec(precision);
+    position->real = viewport->center.real + ratioX * viewport->spanReal;
+    position->imag = viewport->center.imag + ratioY * viewport->spanImag;
+}
+
+
+// Zoom into the position of the cursor by zoomFactor by moving the center towards the
+// cursor position by zoomFactor of their distance and shrinking the view accordingly.
+void zoomInCursor(int x, int y, Viewport *viewport, int width, int height,
+                    double zoomFactor) {
+    BigComplex position;
+    pixelToComplex(viewport, x, y, width, height, &position);
+    zoomInAuto(&position, viewport, width, zoomFactor);
+}
+
+
+// Zoom into the auto zoom target coordinates by zoomFactor. Moving both corners towards
+// the target by zoomFactor of their distance is the same as moving the center and
+// shrinking the span by (1 - zoomFactor).
+void zoomInAuto(const BigComplex *target, Viewport *viewport, int width,
+                    double zoomFactor) {
+    viewport->center.real += zoomFactor * (target->real - viewport->center.real);
+    viewport->center.imag += zoomFactor * (target->imag - viewport->center.imag);
+    viewport->spanReal *= (1 - zoomFactor);
+    viewport->spanImag *= (1 - zoomFactor);
+    updatePrecision(viewport, width);
+}
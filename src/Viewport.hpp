@@ -0,0 +1,92 @@
+#pragma once
+#include <gmpxx.h>
+#include <istream>
+#include <ostream>
+#include "Kernel.hpp"
+
+
+// Complex number with arbitrary precision real and imaginary part, used for everything
+// that has to stay exact when zooming past double precision.
+struct BigComplex {
+    mpf_class real;
+    mpf_class imag;
+};
+
+
+// The part of the complex plane that is rendered, stored as a high precision center plus
+// the size of the view. spanReal is lowerRight.real - upperLeft.real and spanImag is
+// lowerRight.imag - upperLeft.imag, which is negative because pixel rows go downwards.
+struct Viewport {
+    BigComplex center;
+    mpf_class spanReal;
+    mpf_class spanImag;
+};
+
+
+// Initialize the viewport from the upperLeft and lowerRight complex number anchors.
+void initViewport(Viewport *viewport, const Complex<double> *upperLeft,
+                  const Complex<double> *lowerRight);
+
+
+// Initialize the viewport centered on center and spanReal wide, with the height of the
+// view following from the aspect ratio of a width x height frame.
+void initViewportCentered(Viewport *viewport, const BigComplex *center,
+                          const mpf_class &spanReal, int width, int height);
+
+
+// Parse a decimal number with as many bits of precision as its digits need.
+mpf_class parseBig(const char *text);
+
+
+// Round a high precision number to one of the kernel number types.
+template <typename Number>
+Number bigToNumber(const mpf_class &value);
+
+
+// Round the viewport to the upperLeft and lowerRight anchors in the given number type.
+template <typename Number>
+void viewportAnchors(const Viewport *viewport, Complex<Number> *upperLeft,
+                     Complex<Number> *lowerRight);
+
+
+// Write one number exactly as GMP holds it: its precision in bits, its size and exponent
+// in limbs, then its limbs in hexadecimal.
+void writeBig(std::ostream& out, const mpf_class& value);
+
+
+// Read a number written by writeBig() at the precision it was written with. Returns false
+// if the text isn't one.
+bool readBig(std::istream& in, mpf_class* value);
+
+
+// Write the viewport as text that readViewport() turns back into exactly the same
+// viewport, bit for bit and at the same precision.
+void writeViewport(std::ostream& out, const Viewport *viewport);
+
+
+// Read a viewport written by writeViewport(). Returns false if the text isn't one.
+bool readViewport(std::istream& in, Viewport *viewport);
+
+
+// Whether two viewports show exactly the same part of the complex plane.
+bool sameViewport(const Viewport *a, const Viewport *b);
+
+
+// Binary exponent of the distance between two pixels, so 2^exponent is roughly the
+// pixel spacing. Unlike a double this doesn't underflow at any zoom depth.
+long pixelSpacingExp(const Viewport *viewport, int width);
+
+
+// Complex value of the (possibly fractional) pixel position (x, y).
+void pixelToComplex(const Viewport *viewport, double x, double y, int width, int height,
+                    BigComplex *position);
+
+
+// Zoom into the position of the cursor by zoomFactor.
+void zoomInCursor(int x, int y, Viewport *viewport, int width, int height,
+                    double zoomFactor);
+
+
+// Zoom into the auto zoom target coordinates by zoomFactor.
+void zoomInAuto(const BigComplex *target, Viewport *viewport, int width,
+                    double zoomFactor);